@@ -25,20 +25,98 @@ A reasonably efficient implementation should be able to solve *any* randomly gen
 #include <stdbool.h>
 #include <limits.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 #include "dbg.h"
 
 
-#define RANDOM_STEPS 100000
+#ifndef BOARD_WIDTH /* board dimensions, e.g. -DBOARD_WIDTH=4 -DBOARD_HEIGHT=4 for the 15-puzzle */
+#define BOARD_WIDTH 3
+#endif
+#ifndef BOARD_HEIGHT
+#define BOARD_HEIGHT 3
+#endif
+#if BOARD_WIDTH < 2 || BOARD_WIDTH > 4 || BOARD_HEIGHT < 2 || BOARD_HEIGHT > 4
+#error "board sides must be 2 to 4 cells: a state holds 4 bits per cell in 64 bits"
+#endif
+#define BOARD_CELLS (BOARD_WIDTH * BOARD_HEIGHT)
+
+#if BOARD_CELLS <= 9 /* closed set indexed by permutation rank */
+#define BOARD_RANKED 1
 #define MAX_MOVES 50 /* max f_score discovered is 37 for manhattan distance on hardest puzzle (31 moves) */
-#define PERMUTATIONS 196613 /* total permutations: 9! = 181440; has to be prime */
-#define PRIME 24593
-#define END_STATE 0x087654321 /* hexadecimal encoding of final state */
+#if BOARD_CELLS == 4
+#define TILE_PERMUTATIONS 3
+#elif BOARD_CELLS == 6
+#define TILE_PERMUTATIONS 60
+#elif BOARD_CELLS == 8
+#define TILE_PERMUTATIONS 2520
+#else
+#define TILE_PERMUTATIONS 20160 /* arrangements of tiles for each blank index: 8!/2 */
+#endif
+#define PERMUTATIONS (BOARD_CELLS * TILE_PERMUTATIONS) /* reachable permutations: 9!/2, indexed by permutation rank */
+#define CLOSED_GENERATIONS 0xFFFF /* generation stamps wrap after as many */
+#else /* closed set is a hash table of states */
+#define BOARD_RANKED 0
+#define MAX_MOVES 100 /* hardest 15-puzzle takes 80 moves */
+#ifndef CLOSED_BITS
+#define CLOSED_BITS 23 /* log2 of closed set slots, 16 bytes each */
+#endif
+#define CLOSED_PROBES 64 /* closed set is full if a state finds no slot within as many probes */
+#define CLOSED_GENERATIONS 0xFFFFFFFFu
+#endif
+#define END_TILE(i) ((i) < BOARD_CELLS - 1 ? (unsigned long)((i) + 1) << (4 * (i)) : 0UL)
+#define END_STATE (END_TILE(0) | END_TILE(1) | END_TILE(2) | END_TILE(3) | \
+		   END_TILE(4) | END_TILE(5) | END_TILE(6) | END_TILE(7) | \
+		   END_TILE(8) | END_TILE(9) | END_TILE(10) | END_TILE(11) | \
+		   END_TILE(12) | END_TILE(13) | END_TILE(14)) /* hexadecimal encoding of final state */
 #define TEST_STATE1 0x123058746 /* 31 moves */
 #define TEST_STATE2 0x103452768 /* 31 moves */
 #define ITERATIONS 500 /* number of generated puzzles */
+#define POOL_SLAB 4096 /* boards per slab of node pool */
+#define QUEUE_KEYS (4 * MAX_MOVES) /* keys of priority queue: f_score, or g + w * h of weighted astar */
+#define ENGINE_ASTAR 0 /* search engines */
+#define ENGINE_IDA 1
+#define ENGINE_ORACLE 2
+#define ENGINE_HDA 3
+#define ENGINE_BIDIR 4
+#define ENGINE_WASTAR 5
+#define ENGINE_ARA 6
+#define ORACLE_MAGIC "8PZO" /* magic of distance oracle file */
+#define ORACLE_VERSION 2
+#define PDB_MAGIC "SPDB" /* magic of pattern database file */
+#define PDB_VERSION 2
+#define PDB_MAX_GROUPS 4 /* maximum number of disjoint groups in pattern database */
+#define PDB_MAX_TILES 8 /* maximum number of tiles in a group */
+#define CACHE_WAYS 8 /* entries per set of solution cache */
+#define CACHE_HITS_MAX 0xFFFF /* cached boards requeued by astar per solve */
+#define STRINGIFY(x) #x
+#define BOARD_NAME(width, height) STRINGIFY(width) "x" STRINGIFY(height)
+#if BOARD_CELLS == 9 /* default pattern database */
+#define PDB_DEFAULT "3x3:1,2,3,4/5,6,7,8"
+#elif BOARD_CELLS == 16
+#define PDB_DEFAULT "4x4:1,2,3,4,5/6,7,8,9,10/11,12,13,14,15"
+#elif BOARD_CELLS == 12
+#define PDB_DEFAULT BOARD_NAME(BOARD_WIDTH, BOARD_HEIGHT) ":1,2,3,4,5,6/7,8,9,10,11"
+#else
+#define PDB_DEFAULT BOARD_NAME(BOARD_WIDTH, BOARD_HEIGHT) ":1,2,3"
+#endif
 
  /**********************************************
-   *  END_STATE:
+   *  END_STATE (of the default 3x3 board; tiles are in order on any board,
+   *  with the blank in the last cell):
    *
    *  | 1 | 2 | 3 |
    *  | 4 | 5 | 6 |
@@ -49,54 +127,319 @@ A reasonably efficient implementation should be able to solve *any* randomly gen
    **********************************************/
 
 typedef struct puzzle { 
+  /* board on the priority queue; children are enumerated on demand,
+     and the closed set keeps the parent (24 bytes per board) */
   unsigned long state; /* current state */
-  unsigned long parent; /* parent state */
-  int nmoves; /* number of moves made */
-  int nchildren; /* number of children nodes */
-  unsigned long child[4]; /* array cointaining children states */
-  struct puzzle *next; /* pointer to next board (for prioirtyQ) */
+  struct puzzle *next; /* pointer to next board (for prioirtyQ, and free list of node_pool) */
+  short nmoves; /* number of moves made */
+  short h_score; /* heuristic value of state */
+  unsigned char move; /* move of blank from parent (for hda) */
+  unsigned char cached; /* state is in solution cache, f_score is exact */
+  unsigned short hit; /* of cached board requeued by astar, index of its entry in cache_hits */
 } puzzle;
 
+typedef struct pool_slab {
+  struct pool_slab *next; /* next slab */
+  puzzle boards[POOL_SLAB]; /* boards of slab */
+} pool_slab;
+
+typedef struct node_pool {
+  /* boards are carved out of slabs and kept for reuse across solves */
+  pool_slab *slabs; /* first slab */
+  pool_slab *current; /* slab boards are carved from */
+  int used; /* boards carved from current slab */
+  puzzle *free_list; /* boards released back to pool */
+} node_pool;
+
+typedef struct priorityQ_bucket {
+  puzzle **boards; /* contiguous stack of boards, grown on demand and kept across solves */
+  int count; /* boards on bucket */
+  int capacity; /* boards that fit without growing */
+} priorityQ_bucket;
+
 typedef struct priorityQ {
   int nelements; /* current number of queue elements */
   int min_index; /* index of current minimum f-score */
-  puzzle *queue[MAX_MOVES]; /* priority Q indexed by f-score */
+  int max_g[QUEUE_KEYS]; /* highest number of moves with boards, by f-score; -1 if none */
+  priorityQ_bucket queue[QUEUE_KEYS][MAX_MOVES]; /* priority Q indexed by f-score (or key), then number of moves */
+#ifdef SEARCH_STATS
+  int occupied; /* non-empty buckets */
+#endif
 } priorityQ;
 
-typedef struct hash_node {
-  /* hash table stores information of state, parent state, 
-     whether state is discovered, processed */
-  unsigned long state;
-  unsigned long parent;
-  bool processed; /* processed upon extracting from priority queue */
-  int f_score; /* if f_score set, state is discovered */
-} hash_node;
+typedef struct closed_node {
+#if BOARD_RANKED
+  /* closed set is indexed by permutation rank of state, and stores f_score,
+     number of moves, the move of the blank from the parent state,
+     whether state is discovered, processed, and the generation (solve)
+     the entry belongs to (4 bytes per state) */
+  unsigned short generation;
+  unsigned short f_score : 6; /* f_score of state, < MAX_MOVES */
+  unsigned short nmoves : 6; /* number of moves made, 0 for initial state */
+  unsigned short parent_move : 2; /* move of blank from parent state */
+  unsigned short discovered : 1; /* set upon discovering state */
+  unsigned short processed : 1; /* processed upon extracting from priority queue */
+#else
+  /* boards too large to rank: closed set is a hash table of states
+     probed by double hashing, storing the same as above (16 bytes per state) */
+  unsigned long state; /* state of slot, if generation is current */
+  unsigned generation; /* generation of slot, current - 1 while being claimed */
+  unsigned char f_score;
+  unsigned char nmoves;
+  unsigned char parent_move : 2;
+  unsigned char discovered : 1;
+  unsigned char processed : 1;
+#endif
+} closed_node;
+
+typedef struct closed_set {
+  /* entries of an earlier generation are empty, so that the table is
+     cleared in O(1) between solves by starting a new generation */
+  closed_node *nodes;
+  unsigned generation; /* current generation, even */
+  long discovered; /* entries of current generation */
+#if !BOARD_RANKED
+  int bits; /* log2 of slots */
+#endif
+} closed_set;
 
+typedef struct memory_bound {
+  long budget; /* bytes of astar */
+  int bits; /* log2 of slots of closed set, on hashed boards */
+  long max_boards; /* boards on priority queue */
+  long max_states; /* states in closed set */
+} memory_bound;
 
 
 /****************************************
- *       OPERATIONS FOR PUZZLE          *
+ *          SEARCH STATISTICS           *
  ****************************************/
 
+/**********************************************
+ *  Built with -DSEARCH_STATS (make stats), searches count their work in
+ *  per-thread counters, which solver_solve clears before each solve and
+ *  copies into its solution; without it, STAT and STAT_TIME compile to
+ *  nothing, or to the timed statement alone. Counters of hda are kept by
+ *  its worker threads, and are not collected.
+ *
+ *  Reading the clock (tens of nanoseconds) costs more than most of the
+ *  operations timed, so STAT_TIME times one in STAT_SAMPLE of them on
+ *  average, at random gaps of 1 to 2 * STAT_SAMPLE - 1 operations (so that
+ *  no fixed pattern of operations is sampled unevenly), and counts that
+ *  time for all STAT_SAMPLE.
+ *  The mean time of reading the clock twice, measured once, is taken off
+ *  each sample, so that times of cheap operations are not mostly clock.
+ **********************************************/
+
+#ifdef SEARCH_STATS
+typedef struct search_stats {
+  long expanded; /* states whose children were generated */
+  long generated; /* children generated */
+  long duplicates; /* children found in closed set, and not improved */
+  long improved; /* children found in closed set with a lower f_score (or fewer moves) */
+  long reopened; /* improved children that were already processed */
+  long stale; /* superseded boards skipped on extraction */
+  long lookups; /* closed set lookups */
+  long probes; /* slots probed by lookups */
+  long max_probes; /* most slots probed by a lookup */
+  long queue_samples; /* extractions from priority queue */
+  long queue_buckets; /* non-empty buckets, summed over extractions */
+  long max_buckets; /* most non-empty buckets at an extraction */
+  long max_queued; /* most boards on priority queue */
+  long ns_heuristic; /* time in heuristic evaluation, in nanoseconds */
+  long ns_successors; /* time in successor generation */
+  long ns_queue; /* time in priority queue operations */
+  long ns_closed; /* time in closed set operations */
+} search_stats;
 
-void enum_states();
+__thread search_stats stats; /* counters of current solve on this thread */
+__thread unsigned long stats_random = 0x9E3779B97F4A7C15UL; /* xorshift state of sampling */
+__thread int stats_countdown = 1; /* operations until the next timed one */
+long stats_overhead; /* mean nanoseconds between two readings of the clock */
+pthread_once_t stats_once = PTHREAD_ONCE_INIT;
 
-puzzle *board_init(unsigned long state, unsigned long parent, int nmoves)
-{ /* initialize board */
+#define STAT_SAMPLE 64 /* operations per timed operation, on average */
+
+long stats_clock(void)
+{ /* monotonic clock, in nanoseconds */
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+void stats_calibrate(void)
+{ /* measure stats_overhead, over many back-to-back readings */
   int i;
-  puzzle *boardp = malloc(sizeof(*boardp));
+  long total = 0;
+  for (i = 0; i < 4096; i++) {
+    long start = stats_clock();
+    total += stats_clock() - start;
+  }
+  stats_overhead = total / 4096;
+}
+
+void stats_reset(void)
+{ /* clear counters of this thread for a new solve */
+  pthread_once(&stats_once, stats_calibrate);
+  memset(&stats, 0, sizeof(stats));
+}
+
+int stats_gap(void)
+{ /* random gap to the next timed operation, STAT_SAMPLE on average */
+  stats_random ^= stats_random << 13;
+  stats_random ^= stats_random >> 7;
+  stats_random ^= stats_random << 17;
+  return 1 + stats_random % (2 * STAT_SAMPLE - 1);
+}
+
+#define STAT(statement) do { statement; } while (0)
+#define STAT_TIME(field, statement) do {				\
+    if (--stats_countdown == 0) {					\
+      long stat_start = stats_clock();					\
+      statement;							\
+      stats.field += STAT_SAMPLE * (stats_clock() - stat_start - stats_overhead); \
+      stats_countdown = stats_gap();					\
+    } else {								\
+      statement;							\
+    }									\
+  } while (0)
+#else
+#define STAT(statement) do { } while (0)
+#define STAT_TIME(field, statement) do { statement; } while (0)
+#endif
+
+
+/****************************************
+ *       OPERATIONS FOR NODE POOL       *
+ ****************************************/
+
+node_pool *pool_init(void)
+{ /* initialize empty node pool, slabs are allocated on demand */
+  node_pool *pool = calloc(1, sizeof(*pool));
+  check_mem(pool);
+  return pool;
+ error:
+  log_info("error allocating memory for node pool");
+  return NULL;
+}
+
+puzzle *pool_alloc(node_pool *pool)
+{ /* take a board from free list, or carve it from current slab */
+  puzzle *boardp = pool->free_list;
+  if (boardp) {
+    pool->free_list = boardp->next;
+    return boardp;
+  }
+  if (pool->current == NULL || pool->used == POOL_SLAB) { /* move on to next slab */
+    pool_slab *next = pool->current ? pool->current->next : pool->slabs;
+    if (next == NULL) { /* all slabs in use, allocate one more */
+      next = malloc(sizeof(*next));
+      check_mem(next);
+      next->next = NULL;
+      if (pool->current) {
+	pool->current->next = next;
+      } else {
+	pool->slabs = next;
+      }
+    }
+    pool->current = next;
+    pool->used = 0;
+  }
+  return &pool->current->boards[pool->used++];
+ error:
+  return NULL;
+}
+
+void pool_release(node_pool *pool, puzzle *boardp)
+{ /* release board back to pool */
+  boardp->next = pool->free_list;
+  pool->free_list = boardp;
+}
+
+void pool_reset(node_pool *pool)
+{ /* release all boards at once, keeping the slabs */
+  pool->current = NULL;
+  pool->used = 0;
+  pool->free_list = NULL;
+}
+
+void pool_free(node_pool *pool)
+{ /* free node pool and its slabs */
+  while (pool->slabs) {
+    pool_slab *next = pool->slabs->next;
+    free(pool->slabs);
+    pool->slabs = next;
+  }
+  free(pool);
+}
+
+
+/****************************************
+ *       OPERATIONS FOR PUZZLE          *
+ ****************************************/
+
+
+/* moves of the blank; opposite moves differ in the lowest bit */
+#define MOVE_UP 0
+#define MOVE_DOWN 1
+#define MOVE_LEFT 2
+#define MOVE_RIGHT 3
+
+typedef struct neighbor_list {
+  int count; /* 2 to 4 */
+  unsigned char cell[4]; /* cells next to the blank, in increasing index */
+  unsigned char move[4]; /* move of the blank to each cell */
+} neighbor_list;
+
+neighbor_list neighbors[BOARD_CELLS]; /* by index of blank */
+const int move_offset[4] = { -BOARD_WIDTH, BOARD_WIDTH, -1, 1 }; /* change of blank index, by move */
+
+void neighbors_init(void)
+{ /* precompute cells next to every index of the blank */
+  const int order[4] = { MOVE_UP, MOVE_LEFT, MOVE_RIGHT, MOVE_DOWN }; /* increasing index */
+  int blank, move, i;
+  for (blank = 0; blank < BOARD_CELLS; blank++) {
+    neighbor_list *next = &neighbors[blank];
+    int col = blank % BOARD_WIDTH;
+    next->count = 0;
+    for (i = 0; i < 4; i++) {
+      move = order[i];
+      if ((move == MOVE_UP && blank < BOARD_WIDTH) ||
+	  (move == MOVE_DOWN && blank >= BOARD_CELLS - BOARD_WIDTH) ||
+	  (move == MOVE_LEFT && col == 0) ||
+	  (move == MOVE_RIGHT && col == BOARD_WIDTH - 1)) continue;
+      next->cell[next->count] = blank + move_offset[move];
+      next->move[next->count] = move;
+      next->count++;
+    }
+  }
+}
+
+int blank_index(unsigned long state)
+{ /* returns index of blank tile: the lowest nibble of state that is 0,
+     found without a loop by and-ing the bits of each nibble of ~state */
+  unsigned long zero = ~state;
+  zero &= zero >> 1;
+  zero &= zero >> 2;
+  return __builtin_ctzl(zero & 0x1111111111111111UL) / 4;
+}
+
+unsigned long slide_tile(unsigned long state, int blank, int cell)
+{ /* move tile at cell into the blank: the blank's nibble is 0, so
+     XOR-ing the tile into both cells transfers it without a branch */
+  unsigned long tile = (state >> (4 * cell)) & 0xF;
+  return state ^ (tile << (4 * cell)) ^ (tile << (4 * blank));
+}
+
+puzzle *board_init(node_pool *pool, unsigned long state, int nmoves)
+{ /* initialize board from pool */
+  puzzle *boardp = pool_alloc(pool);
   check_mem(boardp);
   boardp->state = state;
-  boardp->parent = parent;
   boardp->nmoves = nmoves;
-  boardp->nchildren = 0;
-  
-  for (i = 0; i < 4; i++) {
-    boardp->child[i] = 0;
-  }
-  
+  boardp->h_score = 0;
+  boardp->cached = false;
   boardp->next = NULL;
-  enum_states(boardp); /* enumerate and insert child states */
   
   return boardp;
  error:
@@ -115,12 +458,12 @@ unsigned long swap_tiles(unsigned long state, int index1, int index2)
     log_info("same index");
     return state;
   }
-  if (index1 < 0 || index1 > 8) {
+  if (index1 < 0 || index1 >= BOARD_CELLS) {
 
     log_info("invalid swap");
     return state;
   }
-  if (index2 < 0 || index2 > 8) {
+  if (index2 < 0 || index2 >= BOARD_CELLS) {
     log_info("invalid swap");
     return state;
   }
@@ -144,19 +487,12 @@ unsigned long swap_tiles(unsigned long state, int index1, int index2)
 }
 
 
-void insert_child(puzzle *boardp, unsigned long new_state)
-{ // insert new state into child array of current board
-   boardp->child[boardp->nchildren] = new_state;
-   boardp->nchildren++; /* increment number of children */
-}
-
-
-
-void enum_states(puzzle *boardp)
-{ /* enumerate states from current state, and add them into array of children states */
+int enum_states(unsigned long state, unsigned long child[4])
+{ /* enumerate states from current state into array of children states,
+     returns number of children */
   
   /**********************************************
-   * Indexed as follows:
+   * Indexed as follows (3x3 board):
    *
    *  | 0 | 1 | 2 |
    *  | 3 | 4 | 5 |
@@ -164,66 +500,96 @@ void enum_states(puzzle *boardp)
    *
    *  corresponding to the hexadecimal encoding:
    *  0x876543210
+   *
+   * children are in increasing index of the blank, read from the
+   * neighbor table of the blank's index
    **********************************************/
-  
-  unsigned long state = boardp->state;
-  unsigned blank_index; /* index with no tile */
-  unsigned i = 0;
 
-  while (true) {
-    if (((state >> (4*i)) & 0xF) == 0) { /* find out whether index of blank is */
-      blank_index = i; /* assign blank index */
-      break;
-    }
-    i++;
-  }
-
-  switch(blank_index) {
-  case 0 :
-    insert_child(boardp, swap_tiles(state, 0, 1));
-    insert_child(boardp, swap_tiles(state, 0, 3));
-    break;
-  case 1 :
-    insert_child(boardp, swap_tiles(state, 1, 0));
-    insert_child(boardp, swap_tiles(state, 1, 2));
-    insert_child(boardp, swap_tiles(state, 1, 4));
-    break;
-  case 2:
-    insert_child(boardp, swap_tiles(state, 2, 1));
-    insert_child(boardp, swap_tiles(state, 2, 5));
-    break;
-  case 3:
-    insert_child(boardp, swap_tiles(state, 3, 0));
-    insert_child(boardp, swap_tiles(state, 3, 4));
-    insert_child(boardp, swap_tiles(state, 3, 6));
-    break;
-  case 4:
-    insert_child(boardp, swap_tiles(state, 4, 1));
-    insert_child(boardp, swap_tiles(state, 4, 3));
-    insert_child(boardp, swap_tiles(state, 4, 5));
-    insert_child(boardp, swap_tiles(state, 4, 7));
-    break;
-  case 5:
-    insert_child(boardp, swap_tiles(state, 5, 2));
-    insert_child(boardp, swap_tiles(state, 5, 4));
-    insert_child(boardp, swap_tiles(state, 5, 8));
-    break;
-  case 6:
-    insert_child(boardp, swap_tiles(state, 6, 3));
-    insert_child(boardp, swap_tiles(state, 6, 7));
-    break;
-  case 7:
-    insert_child(boardp, swap_tiles(state, 7, 4));
-    insert_child(boardp, swap_tiles(state, 7, 6));
-    insert_child(boardp, swap_tiles(state, 7, 8));
-    break;
-  case 8:
-    insert_child(boardp, swap_tiles(state, 8, 5));
-    insert_child(boardp, swap_tiles(state, 8, 7));
-    break;
-  default: log_info("invalid blank index %d", blank_index);
+  int blank = blank_index(state);
+  const neighbor_list *next = &neighbors[blank];
+  int i;
+  for (i = 0; i < next->count; i++) {
+    child[i] = slide_tile(state, blank, next->cell[i]);
   }
-    
+  return next->count;
+}
+
+int move_direction(unsigned long parent, unsigned long state)
+{ /* returns move of the blank that generates state from parent */
+  int offset = blank_index(state) - blank_index(parent);
+  switch (offset) {
+  case -BOARD_WIDTH: return MOVE_UP;
+  case BOARD_WIDTH: return MOVE_DOWN;
+  case -1: return MOVE_LEFT;
+  default: return MOVE_RIGHT;
+  }
+}
+
+unsigned long move_blank(unsigned long state, int move)
+{ /* move blank in given direction, returns new state */
+  int blank = blank_index(state);
+  return slide_tile(state, blank, blank + move_offset[move]);
+}
+
+/**************************************************
+ *          OPERATIONS FOR BOARD SYMMETRY         *
+ **************************************************/
+
+/**********************************************
+ *  On a square board, reflecting the board in its main diagonal (the
+ *  cell of row r, column c goes to row c, column r) keeps the blank of
+ *  END_STATE in the last cell, and renaming every tile to the tile that
+ *  END_STATE holds at its reflected cell turns END_STATE into itself. The
+ *  reflection of a state is therefore as far from END_STATE as the state,
+ *  by the reflected moves (UP and LEFT exchange, as do DOWN and RIGHT).
+ *  Tables keep one state of each pair, and heuristics that are not
+ *  symmetric already take the larger of their values for a state and its
+ *  reflection. A board that is not square is its own reflection.
+ **********************************************/
+
+#define BOARD_SYMMETRIC (BOARD_WIDTH == BOARD_HEIGHT)
+
+unsigned char reflect_cell[BOARD_CELLS]; /* reflected cell, by cell */
+unsigned char reflect_tile[16]; /* tile of END_STATE at the reflected cell, by tile */
+
+void symmetry_init(void)
+{ /* precompute reflection of cells and tiles */
+  int i;
+  for (i = 0; i < BOARD_CELLS; i++) {
+    reflect_cell[i] = BOARD_SYMMETRIC ? i % BOARD_WIDTH * BOARD_WIDTH + i / BOARD_WIDTH : i;
+  }
+  for (i = 0; i < 16; i++) {
+    reflect_tile[i] = i; /* tiles off the board stay invalid */
+  }
+  for (i = 0; i < BOARD_CELLS; i++) {
+    reflect_tile[(END_STATE >> (4 * i)) & 0xF] = (END_STATE >> (4 * reflect_cell[i])) & 0xF;
+  }
+}
+
+unsigned long reflect_state(unsigned long state)
+{ /* reflection of state, at the same distance from END_STATE */
+  unsigned long reflected = 0;
+  int i;
+  for (i = 0; i < BOARD_CELLS; i++) {
+    reflected |= (unsigned long)reflect_tile[(state >> (4 * i)) & 0xF] << (4 * reflect_cell[i]);
+  }
+#if BOARD_CELLS < 16
+  reflected |= state >> (4 * BOARD_CELLS) << (4 * BOARD_CELLS); /* keep invalid bits invalid */
+#endif
+  return reflected;
+}
+
+int reflect_move(int move)
+{ /* move of the blank in the reflected board */
+  return BOARD_SYMMETRIC ? move ^ 2 : move;
+}
+
+unsigned long canonical_state(unsigned long state, bool *reflected)
+{ /* the lesser of state and its reflection, the one that tables keep;
+     sets reflected if it is the reflection */
+  unsigned long mirror = BOARD_SYMMETRIC ? reflect_state(state) : state;
+  *reflected = mirror < state;
+  return *reflected ? mirror : state;
 }
 
 /**************************************************
@@ -236,43 +602,37 @@ void print_state(unsigned long state)
   unsigned long temp;
   unsigned long mask = 0xF;
   printf("\n|");
-  for (i = 0; i < 9; i++) {
-    if ((i == 3) || (i == 6)) {
+  for (i = 0; i < BOARD_CELLS; i++) {
+    if (i > 0 && i % BOARD_WIDTH == 0) {
       printf("\n|");
     }
     temp = state >> (4 * i);
     temp = (temp & mask); /* extract value of least-significant 4 bits */
-    printf(" %lu |", temp);
+    printf(BOARD_CELLS > 10 ? " %2lu |" : " %lu |", temp);
     
   }
   printf("\n");
 }
 
-int hash_f(unsigned long state, int i);
+closed_node *closed_find(closed_set *closed, unsigned long state);
 
-void trace(hash_node closed[], unsigned long state)
+void trace(closed_set *closed, unsigned long state)
 {  /* trace a final state to its initial state using information from the closed set 
       prints out states in order of moves made */
   
   unsigned long trace_array[MAX_MOVES];
   unsigned long current_state = state;
+  closed_node *node = closed_find(closed, current_state);
   int j = 0; /* trace array index */
   int move_count = 0;
-  while (current_state != 0) {
-    int i = 0; /* counter hash function */
-    int index;
 
-    trace_array[j] = current_state; /* insert into array in reverse order */
+  trace_array[j] = current_state; /* insert into array in reverse order */
+  j++;
+  while (node->nmoves != 0) { /* undo move of blank to obtain parent state */
+    current_state = move_blank(current_state, node->parent_move ^ 1);
+    node = closed_find(closed, current_state);
+    trace_array[j] = current_state;
     j++;
-
-    while (true) {
-      index = hash_f(current_state, i); /* hash function */
-      if (closed[index].state == current_state) {
-	current_state = closed[index].parent;
-	break;
-      }
-      i++;
-    }
   }
   
   while (j > 0) { /* trace backwards */
@@ -288,30 +648,60 @@ void trace(hash_node closed[], unsigned long state)
  *          GENERATING RANDOM BOARD               *
  **************************************************/
 
-puzzle *random_child(puzzle *boardp)
-{ /* generate random child and returns pointer to child board */
-  int rand_index = rand() % boardp->nchildren;
-  unsigned long child_state = boardp->child[rand_index];
-  puzzle *child_boardp;
-  child_boardp = board_init(child_state, boardp->state, boardp->nmoves + 1);
-  
-  return child_boardp;
+unsigned long random_seed = 1; /* state of random generator, set by -R */
+
+unsigned long random_next(void)
+{ /* next number of random generator (splitmix64): the same seed gives the
+     same instances on any platform, unlike rand() */
+  unsigned long z = (random_seed += 0x9E3779B97F4A7C15UL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+  return z ^ (z >> 31);
 }
 
+bool state_solvable(unsigned long state);
+
+unsigned long permutation_unrank(unsigned long rank)
+{ /* state of permutation of 0..BOARD_CELLS - 1 with rank in [0, BOARD_CELLS!):
+     digits of rank in mixed radix BOARD_CELLS, BOARD_CELLS - 1, ..., 1 choose
+     each cell among the values left */
+  int i, radix;
+  unsigned left = (1u << BOARD_CELLS) - 1; /* bitset of values left */
+  unsigned long state = 0;
+  for (i = 0, radix = BOARD_CELLS; i < BOARD_CELLS; i++, radix--) {
+    unsigned digit = rank % radix;
+    unsigned value = 0;
+    unsigned rest = left;
+    rank /= radix;
+    while (digit--) rest &= rest - 1; /* drop smaller values left */
+    value = __builtin_ctz(rest);
+    left &= ~(1u << value);
+    state |= (unsigned long)value << (4 * i);
+  }
+  return state;
+}
 
 unsigned long random_state()
-{ /* generate random board, and returns state of that board */
-  int i;
+{ /* uniformly random solvable state: unrank a random permutation, and
+     swap the first two tiles if its parity is wrong. the swap pairs the
+     unsolvable permutations one to one with the solvable ones, so every
+     solvable state is twice as likely as before, and no more */
+  unsigned long permutations = 1;
   unsigned long state;
-  puzzle *random_boardp = board_init(END_STATE, 0, 0); 
-  puzzle *next_boardp; /* temporary pointer */
-  for (i = 0; i < RANDOM_STEPS; i++) {
-    next_boardp = random_child(random_boardp);
-    free(random_boardp);
-    random_boardp = next_boardp;
-    } 
-  state = random_boardp->state;
-  free(random_boardp);
+  int i, first = -1; /* first tile */
+  for (i = 2; i <= BOARD_CELLS; i++) {
+    permutations *= i;
+  }
+  state = permutation_unrank(random_next() % permutations);
+  if (state_solvable(state)) return state;
+  for (i = 0; i < BOARD_CELLS; i++) {
+    if (((state >> (4 * i)) & 0xF) == 0) continue;
+    if (first < 0) {
+      first = i;
+      continue;
+    }
+    return swap_tiles(state, first, i);
+  }
   return state;
 }
 
@@ -320,16 +710,26 @@ unsigned long random_state()
  * DATA STRUCTURE & OPERATIONS FOR PRIORITY QUEUE *
  **************************************************/
   
+/**********************************************
+ *  Boards of equal f_score are bucketed by number of moves, and the
+ *  deepest bucket is extracted first: among boards of equal f_score
+ *  those closest to the goal, which cuts the expansions of the last
+ *  f-layer, where many boards tie with the goal's f_score. Buckets are
+ *  contiguous stacks of board pointers (last in, first out).
+ *  There is no decrease-key: a state reached with a lower f_score is
+ *  inserted again, and the search skips the stale board when it is
+ *  extracted (lazy deletion).
+ **********************************************/
+
 priorityQ *priorityQ_init(void)
-{ /* initialize priority queue,
-     priority queue is an array of linked-lists, indexed by f_score */
+{ /* initialize priority queue, empty buckets allocate on first insert */
   int i;
-  priorityQ *priorityQp = malloc(sizeof (*priorityQp));
+  priorityQ *priorityQp = calloc(1, sizeof (*priorityQp));
   check_mem(priorityQp);
   priorityQp->nelements = 0;
   priorityQp->min_index = -1; /* -1 indicates that there are no elements on the queue */
-  for (i = 0; i < MAX_MOVES; i++) {
-    priorityQp->queue[i] = NULL; /* initialize null pointers */
+  for (i = 0; i < QUEUE_KEYS; i++) {
+    priorityQp->max_g[i] = -1;
   }
   return priorityQp;
  error:
@@ -337,96 +737,92 @@ priorityQ *priorityQ_init(void)
   return NULL;
 }
 
-void priorityQ_insert(priorityQ *priorityQp, puzzle *boardp, int f_score)
-{ /* given f_score, insert board into priority queue */
+void priorityQ_reset(priorityQ *priorityQp)
+{ /* remove all boards from priority queue; they belong to their node pool */
+  int f, g;
+  for (f = 0; f < QUEUE_KEYS; f++) {
+    for (g = 0; g <= priorityQp->max_g[f]; g++) {
+      priorityQp->queue[f][g].count = 0;
+    }
+    priorityQp->max_g[f] = -1;
+  }
+  priorityQp->nelements = 0;
+  priorityQp->min_index = -1;
+  STAT(priorityQp->occupied = 0);
+}
+
+bool priorityQ_insert(priorityQ *priorityQp, puzzle *boardp, int f_score)
+{ /* given f_score, insert board into priority queue, in the bucket of
+     its number of moves; returns false if bucket fails to grow */
+  priorityQ_bucket *bucket = &priorityQp->queue[f_score][boardp->nmoves];
+  if (bucket->count == bucket->capacity) {
+    int capacity = bucket->capacity ? 2 * bucket->capacity : 64;
+    puzzle **boards = realloc(bucket->boards, capacity * sizeof(puzzle *));
+    check_mem(boards);
+    bucket->boards = boards;
+    bucket->capacity = capacity;
+  }
+  STAT(priorityQp->occupied += bucket->count == 0);
+  bucket->boards[bucket->count++] = boardp;
 
   if (priorityQp->min_index > f_score || /* if inserting state with lower f_score */
       priorityQp->min_index == -1) { /* or if min_index not yet set */
     priorityQp->min_index = f_score; /* set min_index to f_score */
   }
-  
-  puzzle *temp =  priorityQp->queue[f_score];/* temporary pointer */
+  if (boardp->nmoves > priorityQp->max_g[f_score]) priorityQp->max_g[f_score] = boardp->nmoves;
+  priorityQp->nelements++; /* increment element counter */
+  STAT(if (priorityQp->nelements > stats.max_queued) stats.max_queued = priorityQp->nelements);
+  return true;
+ error:
+  log_info("error allocating memory for priority queue bucket");
+  return false;
+}
 
-  if (temp == NULL) { /* empty slot */
-    priorityQp->queue[f_score] = boardp; /* insert into empty slot */
-  } else {
-    priorityQp->queue[f_score] = boardp; /* insert into head of linked-list */
-    boardp->next = temp; 
+priorityQ_bucket *priorityQ_min_bucket(priorityQ *priorityQp)
+{ /* non-empty bucket of least f_score and most moves; queue must not be empty */
+  while (true) {
+    int f = priorityQp->min_index;
+    int *g = &priorityQp->max_g[f];
+    while (*g >= 0 && priorityQp->queue[f][*g].count == 0) (*g)--;
+    if (*g >= 0) return &priorityQp->queue[f][*g];
+    priorityQp->min_index++; /* if index is empty */
   }
-  priorityQp->nelements++; /* increment element counter */
 }
 
 puzzle *priorityQ_extract_min(priorityQ *priorityQp)
 { /* extract minimum board from priority queue, and update priority queue */
-
+  priorityQ_bucket *bucket;
   if (priorityQp->nelements == 0 || priorityQp->min_index == -1) {
     log_info("error: no elements to extract");
     return NULL; /* no elements to extract */
   }
-  
-  while (priorityQp->queue[priorityQp->min_index] == NULL) { /* if index is empty */
-      priorityQp->min_index++;
-  }
-  
-  puzzle *min_boardp = priorityQp->queue[priorityQp->min_index]; /* extract first node of linked list */
-  priorityQp->queue[priorityQp->min_index] = min_boardp->next; 
- 
-  priorityQp->nelements --; /* decrease number of elements */
-
+  bucket = priorityQ_min_bucket(priorityQp);
+  STAT(stats.queue_samples++;
+       stats.queue_buckets += priorityQp->occupied;
+       if (priorityQp->occupied > stats.max_buckets) stats.max_buckets = priorityQp->occupied;
+       priorityQp->occupied -= bucket->count == 1);
+  priorityQp->nelements--; /* decrease number of elements */
   if (priorityQp->nelements == 0) {
     priorityQp->min_index = -1; /* reset min_index if priority queue is empty */
   }
-  return min_boardp; 
+  return bucket->boards[--bucket->count];
 }
 
-bool priorityQ_remove(priorityQ *priorityQp, unsigned long state, int f_score)
-{ /* remove state from priority queue */
-  puzzle *current = priorityQp->queue[f_score];
-  puzzle *temp; /* temporary pointer */
-  if (current == NULL) {
-    log_info("error removing, empty linked list");
-    return false;
-  }
-  if (current->state == state) { /* if state at top of the linked list */
-    priorityQp->queue[f_score] = current->next;
-    free(current);
-    priorityQp->nelements--; /* decrease number of elements */
-    if (priorityQp->nelements == 0) priorityQp->min_index = -1; /* if no elements in priority queue, reset min index */
-    return true;
-  }
-
-  while (current->next->state != state) { /* if state not at the top, traverse linked list */
-    if (current->next == NULL) {
-      log_info("error removing, state not in f_score index");
-      return false;
-    }
-    current = current->next;
-  }
-  temp = current->next;
-  current->next = temp->next;
-  free(temp);
-  priorityQp->min_index--; /* decrease number of elements */
-
-  if (priorityQp->nelements == 0) priorityQp->min_index = -1; /* if no elements in priority queue, reset min index */
-  return true;
+puzzle *priorityQ_min(priorityQ *priorityQp)
+{ /* minimum board of priority queue, left on it; NULL if empty */
+  priorityQ_bucket *bucket;
+  if (priorityQp->nelements == 0) return NULL;
+  bucket = priorityQ_min_bucket(priorityQp);
+  return bucket->boards[bucket->count - 1];
 }
-  
-
 
 void priorityQ_free(priorityQ *priorityQp)
-{ /* free priority queue */
-  if (priorityQp->nelements == 0) {
-    log_info("priority queue is empty");
-  } else {
-    int i = priorityQp->min_index;
-    puzzle *temp; /* temporary pointer */
-    for (; i < MAX_MOVES; i++) {
-      while ( priorityQp->queue[i] != NULL)  {
-	/* successively free head of linked list, until index is empty */
-	temp = priorityQp->queue[i]; 
-	priorityQp->queue[i] = temp->next;
-	free(temp);
-      }
+{ /* free priority queue and its buckets; boards left on it belong to
+     their node pool, and are released all at once by pool_reset */
+  int f, g;
+  for (f = 0; f < QUEUE_KEYS; f++) {
+    for (g = 0; g < MAX_MOVES; g++) {
+      free(priorityQp->queue[f][g].boards);
     }
   }
   free(priorityQp); /* free priority queue array */
@@ -437,266 +833,4744 @@ void priorityQ_free(priorityQ *priorityQp)
  *      OPERATIONS FOR CLOSED SET           *
  ********************************************/
 
-hash_node *closed_init(void)
-{ /* initialize closed set: array of hash_nodes */
-  int i;
-  hash_node *closed = malloc(PERMUTATIONS * sizeof(hash_node));
+unsigned long closed_slots(const closed_set *closed)
+{ /* number of slots of closed set */
+#if BOARD_RANKED
+  return PERMUTATIONS;
+#else
+  return 1UL << closed->bits;
+#endif
+}
+
+closed_set *closed_init_bits(int bits)
+{ /* initialize closed set: array of closed_nodes, all of generation 0,
+     with 2^bits slots on hashed boards (ranked boards have one per rank) */
+  closed_set *closed = malloc(sizeof(*closed));
   check_mem(closed);
-  
-  for (i = 0; i < PERMUTATIONS; i++) {
-    closed[i].state = 0;
-    closed[i].parent = 0;
-    closed[i].processed = false;
-    closed[i].f_score = INT_MAX; /* INT_MAX indicates state is not yet discovered */
-  }
+#if !BOARD_RANKED
+  closed->bits = bits;
+#endif
+  closed->nodes = calloc(closed_slots(closed), sizeof(closed_node));
+  check_mem(closed->nodes);
+  closed->generation = 2;
+  closed->discovered = 0;
   return closed;
  error:
   log_info("error in allocating memory for closed set");
+  free(closed);
   return NULL;
 }
 
+closed_set *closed_init(void)
+{ /* initialize closed set of default size */
+#if BOARD_RANKED
+  return closed_init_bits(0);
+#else
+  return closed_init_bits(CLOSED_BITS);
+#endif
+}
+
+
+#if BOARD_RANKED
+int state_rank(unsigned long state)
+{ /* perfect hash of solvable state into [0, PERMUTATIONS):
+   * blank index * (BOARD_CELLS - 1)!/2 + lexicographic (Lehmer code) rank of the tiles / 2.
+   * for a fixed blank index, solvable states share the parity of their tiles,
+   * and permutations with consecutive ranks 2k, 2k + 1 differ in parity */
+  int i;
+  int blank = 0;
+  int rank = 0;
+  int ntiles = 0; /* number of tiles ranked */
+  unsigned seen = 0; /* bitset of tiles ranked */
+  for (i = 0; i < BOARD_CELLS; i++) {
+    unsigned tile = (state >> (4 * i)) & 0xF;
+    if (tile == 0) {
+      blank = i;
+      continue;
+    }
+    /* Lehmer digit: number of smaller tiles not yet ranked */
+    rank = rank * (BOARD_CELLS - 1 - ntiles) + (tile - 1) - __builtin_popcount(seen & ((1u << tile) - 1));
+    seen |= 1u << tile;
+    ntiles++;
+  }
+  return blank * TILE_PERMUTATIONS + rank / 2;
+}
+
+unsigned long state_unrank(int rank)
+{ /* solvable state of rank, inverse of state_rank: of the two tile
+     permutations with Lehmer rank 2k and 2k + 1, the solvable one */
+  int blank = rank / TILE_PERMUTATIONS;
+  int lehmer = 2 * (rank % TILE_PERMUTATIONS);
+  int parity;
+  for (parity = 0; parity < 2; parity++) {
+    int digit[BOARD_CELLS - 1];
+    int i, cell, r = lehmer + parity;
+    unsigned left = ((1u << BOARD_CELLS) - 1) & ~1u; /* bitset of tiles left */
+    unsigned long state = 0;
+    for (i = BOARD_CELLS - 2; i >= 0; i--) { /* least significant digit last */
+      digit[i] = r % (BOARD_CELLS - 1 - i);
+      r /= BOARD_CELLS - 1 - i;
+    }
+    for (i = 0, cell = 0; i < BOARD_CELLS - 1; i++, cell++) {
+      unsigned rest = left;
+      unsigned tile;
+      int d = digit[i];
+      if (cell == blank) cell++;
+      while (d--) rest &= rest - 1; /* drop smaller tiles left */
+      tile = __builtin_ctz(rest);
+      left &= ~(1u << tile);
+      state |= (unsigned long)tile << (4 * cell);
+    }
+    if (state_solvable(state)) return state;
+  }
+  return END_STATE; /* not reached */
+}
+
+closed_node *closed_find(closed_set *closed, unsigned long state)
+{ /* closed set entry of state, cleared if left by an earlier generation */
+  closed_node *node = &closed->nodes[state_rank(state)];
+  STAT(stats.lookups++; stats.probes++; stats.max_probes = 1);
+  if (node->generation != (unsigned short)closed->generation) {
+    *node = (closed_node){ .generation = closed->generation };
+    __atomic_fetch_add(&closed->discovered, 1, __ATOMIC_RELAXED); /* hda threads share it */
+  }
+  return node;
+}
+
+closed_node *closed_lookup(closed_set *closed, unsigned long state)
+{ /* closed set entry of state, to be read only; NULL if state is not found */
+  closed_node *node = &closed->nodes[state_rank(state)];
+  STAT(stats.lookups++; stats.probes++; stats.max_probes = 1);
+  return node->generation == (unsigned short)closed->generation ? node : NULL;
+}
+#else
+closed_node *closed_find(closed_set *closed, unsigned long state)
+{ /* closed set entry of state, claiming an empty slot if state is not found,
+     returns NULL if closed set is full. a slot is empty unless of the current
+     generation; it is claimed by moving its generation to current - 1, which
+     makes other threads wait until the state is written, so that threads may
+     look up distinct states concurrently (hda) */
+  unsigned long hash = state * 0x9E3779B97F4A7C15UL;
+  unsigned index = hash >> (64 - closed->bits);
+  unsigned step = (hash >> (32 - closed->bits)) | 1; /* odd, so probes visit every slot */
+  unsigned current = closed->generation;
+  int i;
+  STAT(stats.lookups++);
+  for (i = 0; i < CLOSED_PROBES; i++) {
+    closed_node *node = &closed->nodes[index];
+    unsigned found = __atomic_load_n(&node->generation, __ATOMIC_ACQUIRE);
+    STAT(stats.probes++; if (i + 1 > stats.max_probes) stats.max_probes = i + 1);
+    if (found != current && found != current - 1 &&
+	__atomic_compare_exchange_n(&node->generation, &found, current - 1, false,
+				    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      node->f_score = node->nmoves = 0;
+      node->parent_move = node->discovered = node->processed = 0;
+      __atomic_store_n(&node->state, state, __ATOMIC_RELAXED);
+      __atomic_store_n(&node->generation, current, __ATOMIC_RELEASE);
+      __atomic_fetch_add(&closed->discovered, 1, __ATOMIC_RELAXED);
+      return node; /* claimed */
+    }
+    while (found == current - 1) { /* claimed by another thread, state not yet written */
+      found = __atomic_load_n(&node->generation, __ATOMIC_ACQUIRE);
+    }
+    if (found == current && __atomic_load_n(&node->state, __ATOMIC_RELAXED) == state) return node;
+    index = (index + step) & (closed_slots(closed) - 1);
+  }
+  return NULL;
+}
 
-int hash_f(unsigned long state, int i)
-{ /* returns hash value, given state and count (double probing) */
-  return ((state % PERMUTATIONS) + (i * ( PRIME - (state % PRIME)))) % PERMUTATIONS;
+closed_node *closed_lookup(closed_set *closed, unsigned long state)
+{ /* closed set entry of state, to be read only; NULL if state is not found */
+  unsigned long hash = state * 0x9E3779B97F4A7C15UL;
+  unsigned index = hash >> (64 - closed->bits);
+  unsigned step = (hash >> (32 - closed->bits)) | 1;
+  unsigned current = closed->generation;
+  int i;
+  STAT(stats.lookups++);
+  for (i = 0; i < CLOSED_PROBES; i++) {
+    closed_node *node = &closed->nodes[index];
+    unsigned found = __atomic_load_n(&node->generation, __ATOMIC_ACQUIRE);
+    STAT(stats.probes++; if (i + 1 > stats.max_probes) stats.max_probes = i + 1);
+    while (found == current - 1) {
+      found = __atomic_load_n(&node->generation, __ATOMIC_ACQUIRE);
+    }
+    if (found != current) return NULL; /* empty */
+    if (__atomic_load_n(&node->state, __ATOMIC_RELAXED) == state) return node;
+    index = (index + step) & (closed_slots(closed) - 1);
+  }
+  return NULL;
 }
+#endif
 
-int closed_discover(hash_node closed[], unsigned long state, unsigned long parent, int f_score)
+int closed_discover(closed_set *closed, unsigned long state, unsigned long parent, int nmoves, int f_score)
 { /* search closed set for state:
-   * if not found, set to discovered, update state, parent and update f_score. return f_score
+   * if not found, set to discovered, update move from parent, nmoves and f_score. return f_score
    * if found and processed, do nothing. return INT_MAX.
    * if found and not processed, compare f_scores:
-   *  - if f_score lower than existing, update f_score, and return old f_score
+   *  - if f_score lower than existing, update, and return old f_score
    *  - if f_score higher or equivalent to existing, do nothing. return INT_MAX.
+   * if closed set is full, return -1.
    */
 
-  int i = 0; /* counter for hash function */
   int old_f_score;
-  int index;
+  closed_node *node = closed_find(closed, state);
 
-  while (true) {
-    index = hash_f(state, i);  /* hash function */
-    if (closed[index].state == 0) {
-      closed[index].state = state; /* discover state */
-      closed[index].parent = parent;
-      closed[index].f_score = f_score;
-      return f_score;
-    } else if (closed[index].state == state) { /* if found */
-      if (closed[index].processed == true) { /* if processed */
-	return INT_MAX; /* do nothing */
-      } else {
-	if (f_score >= closed[index].f_score) { /* f_score higher than existing */
-	  return INT_MAX; /* do nothing */
-	} else {
-	  old_f_score = closed[index].f_score;
-	  closed[index].f_score = f_score; /* update f_score */
-	  //log_info("updated state with f_score: %d ", f_score);
-	  return old_f_score;
-	}
-      }
+  if (node == NULL) {
+    log_err("closed set is full");
+    return -1;
+  }
+
+  if (node->discovered) {
+    if (node->processed || f_score >= node->f_score) { /* processed, or f_score higher than existing */
+      STAT(stats.duplicates++);
+      return INT_MAX; /* do nothing */
     }
-    i++;
+    STAT(stats.improved++);
+    old_f_score = node->f_score;
+  } else {
+    node->discovered = true; /* discover state */
+    old_f_score = f_score;
   }
+  node->f_score = f_score;
+  node->nmoves = nmoves;
+  if (nmoves != 0) node->parent_move = move_direction(parent, state);
+  return old_f_score;
 }
 
-bool closed_process(hash_node closed[], unsigned long state)
-{ /* search closed set for state and set to processed */
-
-  int i = 0; /* counter hash function */
-  int index;
-
-  while (true) {
-    index = hash_f(state, i); /* hash function */
-    if (closed[index].state == 0) {
-      log_info("state not yet discovered");
-      return false;
-    } else if (closed[index].state == state) {
-      if (closed[index].processed == true) log_info("state already processed");
-      closed[index].processed = true;
-      return true;
-    }
-    i++;
+int closed_moves(closed_set *closed, unsigned long state, unsigned char moves[])
+{ /* moves of the blank from initial state to state, as recorded in closed set,
+     returns number of moves */
+  closed_node *node = closed_find(closed, state);
+  int nmoves = node->nmoves;
+  int i;
+  for (i = nmoves - 1; i >= 0; i--) { /* undo moves back to initial state */
+    moves[i] = node->parent_move;
+    state = move_blank(state, node->parent_move ^ 1);
+    node = closed_find(closed, state);
   }
+  return nmoves;
 }
 
+long closed_reset(closed_set *closed)
+{ /* clear closed set for next instance by starting a new generation, and
+     return count of states that have been discovered/processed */
+  long count = closed->discovered;
+  closed->discovered = 0;
+  closed->generation += 2;
+  if (closed->generation >= CLOSED_GENERATIONS) { /* stamps wrap: clear once */
+    memset(closed->nodes, 0, closed_slots(closed) * sizeof(closed_node));
+    closed->generation = 2;
+  }
+  return count;
+}
 
-int closed_free(hash_node closed[])
+long closed_free(closed_set *closed)
 { /* free closed set and
      return count of states that have been discovered/processed */
-  int i;
-  int count = 0;
-  for (i = 0; i < PERMUTATIONS; i++) {
-    if (closed[i].state != 0) {
-      count++;
-    }
-  } 
-
+  long count = closed->discovered;
+  free(closed->nodes);
   free(closed);
   return count;
 }
 
 /********************************************
- *       OPERATIONS FOR A* SEARCH           *
+ *      OPERATIONS FOR SOLUTION CACHE       *
  ********************************************/
 
-int no_heuristic(unsigned long state, int nmoves)
-{ /* f_score = number of moves made */
-  return nmoves;
-}
-
-int misplaced_tile_heuristic(long unsigned state, int nmoves)
-{ /* f_score = number of misplaced tiles + number of moves made */
-  /* remember to exclude blank tile */
-  int i;
-  int misplaced = 0; /* number of misplaced tiles */
-  bool blank_misplaced = true;
-  
-  unsigned long mask = 0xF;
-  unsigned long extract_same = state ^ END_STATE; /* returns 0000 (binary) where sequence matches */
-  for (i = 0; i < 8; i++) {
-    if (blank_misplaced == true) {
-	if (((state & mask) == 0) && ((END_STATE & mask)== 0)) { /* if blank matches */
-	  blank_misplaced = false;
-	}
-      }
-    if (!((extract_same & mask) == 0)) { /* if 4-bit pattern do not match */
-	misplaced ++;
-      }
-    mask = mask << 4;
-  }
+/**********************************************
+ *  Every state on an optimal solution is at its exact distance from
+ *  END_STATE, and the rest of the solution is an optimal continuation
+ *  from it. After each solve, the states of the solution are cached
+ *  with their distance and continuation, packed 2 bits per move, so a
+ *  repeated query is answered from the cache, and astar stops as soon
+ *  as a cached state is the best board on its queue (see a_star_step).
+ *  The cache is shared by all solver contexts: a table of sets of
+ *  CACHE_WAYS entries, evicting by CLOCK within the set (a hit marks an
+ *  entry referenced; the hand clears marks until it finds an unreferenced
+ *  entry). The states of a set fill one cache line and are scanned
+ *  without its lock, which is only taken on a match, or to insert.
+ *  A state and its reflection share one entry, under canonical_state:
+ *  the moves of the other are the reflected moves, 2 bits flipped each.
+ **********************************************/
 
-  if (blank_misplaced == true) misplaced--; /* do not include count for misplaced blank */
+typedef struct cache_entry {
+  unsigned char distance; /* number of moves of optimal solution */
+  unsigned char referenced; /* hit since the hand last passed */
+  unsigned char moves[(MAX_MOVES + 3) / 4]; /* moves of the blank, 2 bits each */
+} cache_entry;
 
-  return misplaced + nmoves;
-}
+typedef struct cache_set {
+  _Atomic unsigned long states[CACHE_WAYS]; /* state of each way, 0 if empty */
+  atomic_flag lock; /* guards entries, and writes of states */
+  int hand; /* next way considered for eviction */
+  cache_entry ways[CACHE_WAYS];
+} __attribute__((aligned(64))) cache_set; /* states on a cache line of their own */
 
-int manhattan_distance_heuristic(unsigned long state, int nmoves)
-{ /* f_score =  manhattan distance + nmoves */
-  
-  if (state == END_STATE) return 0 + nmoves;
-  
-  int i;
-  unsigned long tile; /* current tile */
-  int index1, index2; /* tile index for state and end state */
-  int x1, x2, y1, y2; /* x and y coordinates for tile */
-  unsigned long mask = 0xF;
-  int distance = 0;
+typedef struct solution_cache {
+  cache_set *sets;
+  unsigned long nsets; /* power of 2 */
+  atomic_long queries; /* solves of solver_solve */
+  atomic_long hits; /* of queries and of astar */
+} solution_cache;
 
-  
-  for (tile = 1; tile < 9;tile++) {
-    i = 0;
-    while (i < 9) {
-      if ((((state >> (4 * i))^tile) & mask) == 0) index1 = i; /* extract tile index for state */
-      if ((((END_STATE >> (4 * i))^tile) & mask) == 0) index2 = i; /* extract tile index for end state */
-      i++;
-    }
-    
-    if (index1 == index2) continue;
-    
-    x1 = index1 / 3;
-    x2 = index2 / 3;
+solution_cache *cache = NULL; /* shared by solver contexts, set by -c */
 
-    y1 = index1 % 3;
-    y2 = index2 % 3;
+typedef struct cache_hits {
+  /* entries of the cached boards astar requeued during one solve: the
+     board keeps its entry, which another thread may evict meanwhile */
+  cache_entry *entries;
+  int count, capacity;
+} cache_hits;
 
-    distance += abs(y1 - y2) + abs(x1 - x2);
+solution_cache *cache_init(long entries)
+{ /* initialize empty cache of at least entries entries */
+  solution_cache *cachep = calloc(1, sizeof(*cachep));
+  unsigned long i;
+  check_mem(cachep);
+  cachep->nsets = 1;
+  while (cachep->nsets * CACHE_WAYS < (unsigned long)entries) cachep->nsets *= 2;
+  cachep->sets = aligned_alloc(64, cachep->nsets * sizeof(cache_set));
+  check_mem(cachep->sets);
+  memset(cachep->sets, 0, cachep->nsets * sizeof(cache_set));
+  for (i = 0; i < cachep->nsets; i++) {
+    atomic_flag_clear(&cachep->sets[i].lock);
   }
+  atomic_init(&cachep->queries, 0);
+  atomic_init(&cachep->hits, 0);
+  return cachep;
+ error:
+  log_info("error allocating memory for solution cache");
+  if (cachep) free(cachep->sets);
+  free(cachep);
+  return NULL;
+}
 
-  return distance + nmoves;
+cache_set *cache_set_of(solution_cache *cachep, unsigned long state)
+{ /* set of state, by fibonacci hashing */
+  return &cachep->sets[(state * 0x9E3779B97F4A7C15UL >> 32) & (cachep->nsets - 1)];
 }
 
+void cache_lock(cache_set *set)
+{
+  while (atomic_flag_test_and_set_explicit(&set->lock, memory_order_acquire)) {
+    sched_yield();
+  }
+}
 
-puzzle *a_star_step(priorityQ *priorityQp, hash_node closed[], int (*heuristic)(unsigned long int state, int nmoves))
-{ /* performs one step of a_star */  
-  int i;
-  puzzle *candidate;
-  puzzle *next_boardp = priorityQ_extract_min(priorityQp);
- 
-  if (next_boardp == NULL) log_info("error, failed to extract from priority queue");
+void cache_unlock(cache_set *set)
+{
+  atomic_flag_clear_explicit(&set->lock, memory_order_release);
+}
 
-  if (next_boardp->state == END_STATE) { /* solved */
-    return next_boardp;
+bool cache_lookup(solution_cache *cachep, unsigned long state, cache_entry *entry)
+{ /* copy entry of state into entry, returns false if state is not cached */
+  bool reflected;
+  cache_set *set;
+  int i;
+  state = canonical_state(state, &reflected);
+  set = cache_set_of(cachep, state);
+  for (i = 0; i < CACHE_WAYS; i++) {
+    if (atomic_load_explicit(&set->states[i], memory_order_relaxed) != state) continue;
+    cache_lock(set);
+    if (atomic_load_explicit(&set->states[i], memory_order_relaxed) != state) { /* evicted meanwhile */
+      cache_unlock(set);
+      return false;
+    }
+    set->ways[i].referenced = true;
+    *entry = set->ways[i];
+    cache_unlock(set);
+    if (reflected) {
+      for (i = 0; i < (int)sizeof(entry->moves); i++) {
+	entry->moves[i] ^= 0xAA; /* reflect_move of 4 moves */
+      }
+    }
+    atomic_fetch_add_explicit(&cachep->hits, 1, memory_order_relaxed);
+    return true;
   }
+  return false;
+}
 
-  int f_score;
-  int aux_f_score; /* f_score to determine whether priority queue needs replacement */
- 
-  for (i = 0; i < next_boardp->nchildren; i++) { /* for children of extracted state */
-    f_score = heuristic(next_boardp->child[i], next_boardp->nmoves + 1); /* calculate f_score */
-    aux_f_score = closed_discover(closed, next_boardp->child[i], next_boardp->state, f_score);
-    if (aux_f_score != INT_MAX) { 
-      if (f_score != aux_f_score) { /* need to replace in priority queue */
-	priorityQ_remove(priorityQp, next_boardp->child[i], aux_f_score);
-      }
-      candidate = board_init(next_boardp->child[i], next_boardp->state, next_boardp->nmoves + 1); /* initialize child board */
-      priorityQ_insert(priorityQp, candidate, f_score); /* insert into priority queue */
-    }    
+int cache_moves(const cache_entry *entry, unsigned char moves[])
+{ /* unpack moves of entry, returns number of moves */
+  int i;
+  for (i = 0; i < entry->distance; i++) {
+    moves[i] = (entry->moves[i / 4] >> (2 * (i % 4))) & 3;
   }
-  closed_process(closed, next_boardp->state); /* process state */
+  return entry->distance;
+}
+
+void cache_insert(solution_cache *cachep, unsigned long state, const unsigned char moves[], int nmoves)
+{ /* cache optimal solution of state, evicting by CLOCK if its set is full */
+  bool reflected;
+  cache_set *set;
+  int way = -1;
+  int i;
+  state = canonical_state(state, &reflected);
+  set = cache_set_of(cachep, state);
+  cache_lock(set);
+  for (i = 0; i < CACHE_WAYS; i++) {
+    unsigned long cached = atomic_load_explicit(&set->states[i], memory_order_relaxed);
+    if (cached == state) { /* already cached */
+      cache_unlock(set);
+      return;
+    }
+    if (cached == 0 && way < 0) way = i;
+  }
+  while (way < 0) {
+    if (set->ways[set->hand].referenced) {
+      set->ways[set->hand].referenced = false; /* second chance */
+    } else {
+      way = set->hand;
+    }
+    set->hand = (set->hand + 1) % CACHE_WAYS;
+  }
+  memset(&set->ways[way], 0, sizeof(cache_entry));
+  set->ways[way].distance = nmoves;
+  for (i = 0; i < nmoves; i++) {
+    set->ways[way].moves[i / 4] |= (reflected ? reflect_move(moves[i]) : moves[i]) << (2 * (i % 4));
+  }
+  atomic_store_explicit(&set->states[way], state, memory_order_relaxed);
+  cache_unlock(set);
+}
+
+void cache_insert_path(solution_cache *cachep, unsigned long state, const unsigned char moves[], int nmoves)
+{ /* cache every state on optimal solution of state, with the rest of the solution */
+  int i;
+  for (i = 0; i <= nmoves; i++) {
+    cache_insert(cachep, state, moves + i, nmoves - i);
+    if (i < nmoves) state = move_blank(state, moves[i]);
+  }
+}
+
+int cache_hits_add(cache_hits *hits, const cache_entry *entry)
+{ /* keep copy of entry, returns its index, or -1 if hits are full */
+  if (hits->count == hits->capacity) {
+    int capacity = hits->capacity ? 2 * hits->capacity : 64;
+    cache_entry *entries;
+    if (capacity > CACHE_HITS_MAX) capacity = CACHE_HITS_MAX;
+    if (hits->count == capacity) return -1;
+    entries = realloc(hits->entries, capacity * sizeof(cache_entry));
+    if (entries == NULL) return -1;
+    hits->entries = entries;
+    hits->capacity = capacity;
+  }
+  hits->entries[hits->count] = *entry;
+  return hits->count++;
+}
+
+void cache_free(solution_cache *cachep)
+{ /* log hits, and free cache */
+  log_info("solution cache: %ld queries, %ld hits by queries and astar",
+	   atomic_load(&cachep->queries), atomic_load(&cachep->hits));
+  free(cachep->sets);
+  free(cachep);
+}
+
+
+/********************************************
+ *     OPERATIONS FOR DISTANCE ORACLE       *
+ ********************************************/
+
+/**********************************************
+ *  The oracle stores the exact distance to END_STATE of every
+ *  solvable state, 4 bits per state indexed by oracle_index.
+ *  Distances go up to 31, so the table holds distance mod 16;
+ *  since neighbouring states differ in distance by exactly 1,
+ *  that is enough to descend greedily to END_STATE, and the exact
+ *  distance is the number of steps taken.
+ *
+ *  On a square board, a state with the blank below the main diagonal is
+ *  looked up by its reflection (see reflect_state), so the table only
+ *  holds the states with the blank on or above the diagonal: 6 of the 9
+ *  blank cells of the 3x3 board.
+ *
+ *  A greedy descent takes O(distance) lookups, too many for a heuristic
+ *  called on every child: when the oracle is the heuristic of a search,
+ *  oracle_heuristic_init expands it into exact distances, one byte per
+ *  state by state_rank (PERMUTATIONS bytes), looked up once per call.
+ *
+ *  file format: oracle_header, followed by ORACLE_BYTES bytes
+ **********************************************/
+
+#if BOARD_RANKED
+#if BOARD_SYMMETRIC
+#define ORACLE_BLANKS (BOARD_WIDTH * (BOARD_WIDTH + 1) / 2) /* cells on or above the diagonal */
+#else
+#define ORACLE_BLANKS BOARD_CELLS
+#endif
+#define ORACLE_STATES (ORACLE_BLANKS * TILE_PERMUTATIONS) /* states in oracle */
+#define ORACLE_BYTES ((ORACLE_STATES + 1) / 2)
+
+typedef struct oracle_header {
+  char magic[4]; /* ORACLE_MAGIC */
+  unsigned version; /* ORACLE_VERSION */
+  unsigned nstates; /* ORACLE_STATES */
+  unsigned reserved;
+} oracle_header;
+
+const unsigned char *oracle = NULL; /* packed table, memory-mapped */
+void *oracle_map = NULL; /* start of mapping, including header */
+size_t oracle_map_size = 0;
+unsigned char *oracle_distances = NULL; /* exact distance by state_rank, for oracle_heuristic */
+
+int oracle_index(int rank)
+{ /* index in oracle of state of rank, -1 if the oracle holds its reflection */
+  int blank = rank / TILE_PERMUTATIONS;
+  int row = blank / BOARD_WIDTH;
+  int col = blank % BOARD_WIDTH;
+  if (!BOARD_SYMMETRIC) return rank;
+  if (row > col) return -1;
+  return (row * BOARD_WIDTH - row * (row - 1) / 2 + col - row) * TILE_PERMUTATIONS
+    + rank % TILE_PERMUTATIONS; /* cells on or above the diagonal before blank */
+}
+
+int oracle_lookup(const unsigned char table[], unsigned long state)
+{ /* returns distance mod 16 of state */
+  int index = oracle_index(state_rank(state));
+  if (index < 0) index = oracle_index(state_rank(reflect_state(state)));
+  return (table[index >> 1] >> ((index & 1) * 4)) & 0xF;
+}
+
+unsigned char *distance_table(void)
+{ /* breadth-first search backward from END_STATE over all solvable states,
+     returns exact distance of each state by state_rank, NULL on error */
+  unsigned char *table = malloc(PERMUTATIONS);
+  unsigned long *queue = malloc(PERMUTATIONS * sizeof(*queue)); /* states in order of distance */
+  int head = 0, tail = 0;
+  int i, rank;
+  check_mem(table);
+  check_mem(queue);
+  memset(table, 0xFF, PERMUTATIONS); /* unvisited */
+
+  queue[tail++] = END_STATE;
+  table[state_rank(END_STATE)] = 0;
+  while (head < tail) {
+    unsigned long child[4];
+    int nchildren = enum_states(queue[head], child);
+    int distance = table[state_rank(queue[head++])];
+    for (i = 0; i < nchildren; i++) {
+      rank = state_rank(child[i]);
+      if (table[rank] == 0xFF) {
+	table[rank] = distance + 1;
+	queue[tail++] = child[i];
+      }
+    }
+  }
+  check(tail == PERMUTATIONS, "distance table reached %d states", tail);
+  free(queue);
+  return table;
+ error:
+  free(table);
+  free(queue);
+  return NULL;
+}
+
+bool oracle_build(const char *path)
+{ /* pack distance table 4 bits per state, and save it to path */
+  oracle_header header = { ORACLE_MAGIC, ORACLE_VERSION, ORACLE_STATES, 0 };
+  unsigned char *table = calloc(ORACLE_BYTES, 1);
+  unsigned char *distance = distance_table();
+  int rank, index, max_distance = 0;
+  FILE *file = NULL;
+  check_mem(table);
+  check(distance, "failed to build distance table");
+
+  for (rank = 0; rank < PERMUTATIONS; rank++) {
+    if (distance[rank] > max_distance) max_distance = distance[rank];
+    index = oracle_index(rank);
+    if (index < 0) continue; /* reflection of a state in the table */
+    table[index >> 1] |= (distance[rank] & 0xF) << ((index & 1) * 4);
+  }
+  log_info("oracle built, maximum distance is %d", max_distance);
+
+  file = fopen(path, "wb");
+  check(file, "failed to open %s", path);
+  check(fwrite(&header, sizeof(header), 1, file) == 1, "failed to write %s", path);
+  check(fwrite(table, ORACLE_BYTES, 1, file) == 1, "failed to write %s", path);
+  check(fclose(file) == 0, "failed to close %s", path);
+
+  free(table);
+  free(distance);
+  return true;
+ error:
+  if (file) fclose(file);
+  free(table);
+  free(distance);
+  return false;
+}
+
+bool oracle_load(const char *path)
+{ /* memory-map oracle read-only, so that processes share the table */
+  struct stat st;
+  const oracle_header *header;
+  int fd = open(path, O_RDONLY);
+  check(fd >= 0, "failed to open %s", path);
+  check(fstat(fd, &st) == 0, "failed to stat %s", path);
+  check(st.st_size == sizeof(oracle_header) + ORACLE_BYTES, "invalid size of %s", path);
+
+  oracle_map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  check(oracle_map != MAP_FAILED, "failed to map %s", path);
+  close(fd);
+  fd = -1;
+  oracle_map_size = st.st_size;
+
+  header = oracle_map;
+  check(memcmp(header->magic, ORACLE_MAGIC, 4) == 0 &&
+	header->version == ORACLE_VERSION &&
+	header->nstates == ORACLE_STATES, "invalid header in %s", path);
+  oracle = (const unsigned char *)(header + 1);
+  return true;
+ error:
+  if (fd >= 0) close(fd);
+  if (oracle_map && oracle_map != MAP_FAILED) munmap(oracle_map, st.st_size);
+  oracle_map = NULL;
+  return false;
+}
+
+bool oracle_heuristic_init(void)
+{ /* expand the oracle into exact distances of all states for
+     oracle_heuristic, before threads start: from END_STATE outwards, a
+     neighbour of a state at distance d whose oracle entry is d + 1 mod 16
+     is at distance d + 1. returns false if the oracle does not reach every
+     state so, as with a corrupt file */
+  unsigned long *queue = malloc(PERMUTATIONS * sizeof(*queue)); /* states in order of distance */
+  int head = 0, tail = 0;
+  int i, rank;
+  oracle_distances = malloc(PERMUTATIONS);
+  check_mem(queue);
+  check_mem(oracle_distances);
+  memset(oracle_distances, 0xFF, PERMUTATIONS); /* unvisited */
+  check(oracle_lookup(oracle, END_STATE) == 0, "oracle does not hold the goal at distance 0");
+
+  queue[tail++] = END_STATE;
+  oracle_distances[state_rank(END_STATE)] = 0;
+  while (head < tail) {
+    unsigned long child[4];
+    int nchildren = enum_states(queue[head], child);
+    int distance = oracle_distances[state_rank(queue[head++])] + 1;
+    for (i = 0; i < nchildren; i++) {
+      rank = state_rank(child[i]);
+      if (oracle_distances[rank] == 0xFF && oracle_lookup(oracle, child[i]) == (distance & 0xF)) {
+	oracle_distances[rank] = distance;
+	queue[tail++] = child[i];
+      }
+    }
+  }
+  check(tail == PERMUTATIONS, "oracle reaches %d of %d states", tail, PERMUTATIONS);
+  free(queue);
+  return true;
+ error:
+  free(queue);
+  free(oracle_distances);
+  oracle_distances = NULL;
+  return false;
+}
+
+void oracle_free(void)
+{ /* unmap oracle, and free distances of oracle heuristic */
+  if (oracle_map) munmap(oracle_map, oracle_map_size);
+  oracle_map = NULL;
+  oracle = NULL;
+  free(oracle_distances);
+  oracle_distances = NULL;
+}
+
+int oracle_solve(unsigned long state, unsigned long path[])
+{ /* greedy descent to END_STATE through neighbours one closer to it,
+     stores visited states in path if not NULL, returns number of moves,
+     or -1 if the oracle leads nowhere (a corrupt file, or one of another board) */
+  int i;
+  int nmoves = 0;
+  int distance = oracle_lookup(oracle, state);
+  while (state != END_STATE) {
+    unsigned long child[4];
+    int nchildren = enum_states(state, child);
+    if (path) path[nmoves] = state;
+    if (nmoves == MAX_MOVES - 1) return -1; /* no room for the path */
+    distance = (distance + 15) & 0xF; /* one less, mod 16 */
+    for (i = 0; i < nchildren; i++) {
+      if (oracle_lookup(oracle, child[i]) == distance) break;
+    }
+    if (i == nchildren) return -1; /* no neighbour one closer */
+    state = child[i];
+    nmoves++;
+  }
+  if (path) path[nmoves] = state;
+  return nmoves;
+}
+
+int oracle_heuristic(unsigned long state, int nmoves)
+{ /* f_score = exact distance + number of moves made; by greedy descent
+     if oracle_heuristic_init has not built the distance table */
+  int distance;
+  if (oracle_distances) return oracle_distances[state_rank(state)] + nmoves;
+  distance = oracle_solve(state, NULL);
+  return (distance > 0 ? distance : 0) + nmoves;
+}
+#else /* boards too large to rank have no oracle */
+const unsigned char *oracle = NULL;
+
+bool oracle_build(const char *path)
+{
+  log_err("oracle needs a board of at most 9 cells");
+  return false;
+}
+
+bool oracle_load(const char *path)
+{
+  log_err("oracle needs a board of at most 9 cells");
+  return false;
+}
+
+bool oracle_heuristic_init(void)
+{
+  return false;
+}
+
+void oracle_free(void)
+{
+}
+
+int oracle_solve(unsigned long state, unsigned long path[])
+{
+  return -1;
+}
+
+int oracle_heuristic(unsigned long state, int nmoves)
+{
+  return nmoves;
+}
+#endif
+
+/********************************************
+ *    OPERATIONS FOR EXTERNAL-MEMORY BFS    *
+ ********************************************/
+
+/**********************************************
+ *  Breadth-first enumeration of a state space around a start state, one
+ *  layer (distance) at a time, on disk, for state spaces that do not fit
+ *  in memory: the states of the board around END_STATE (-x DIR), or the
+ *  patterns of a group of tiles of a pattern database around their goal
+ *  cells (-B with -x DIR). A layer is a file of sorted, distinct states
+ *  packed in the bytes of a state of the space each. The successors of
+ *  layer d are collected in a buffer of the memory budget (-M), which is
+ *  sorted and written as a run whenever it fills; the runs are merged (at
+ *  most EXTERNAL_FANIN at a time, in passes) into layer d + 1, dropping
+ *  duplicates and the states of layer d - 1 as they stream by. Every move
+ *  moves the blank, or a tile of the pattern, to a cell of the other
+ *  colour of a chessboard, so no state of layer d or below d - 1 can be a
+ *  successor of layer d: those two merges are all the duplicate detection
+ *  needed. A layer is written under a temporary name and renamed once
+ *  complete, and a new run resumes after the last complete layer of DIR.
+ **********************************************/
+
+#define EXTERNAL_BYTES ((4 * BOARD_CELLS + 7) / 8) /* bytes of packed board state */
+#define EXTERNAL_RUN_BYTES (64L << 20) /* default memory of runs */
+#define EXTERNAL_FANIN 64 /* runs merged at once */
+#define EXTERNAL_CHILDREN (4 * PDB_MAX_TILES) /* most successors of a state of any space */
+
+typedef struct external_space {
+  int nbytes; /* bytes of packed state */
+  int (*successors)(const struct external_space *space, unsigned long state, unsigned long child[]);
+  int width, ncells, ntiles; /* board and group size of pattern states */
+} external_space;
+
+typedef struct external_reader {
+  FILE *file;
+  int nbytes; /* bytes of packed state */
+  unsigned long state; /* last state read */
+  int depth; /* layer of file, for external_table */
+} external_reader;
+
+int external_board_successors(const external_space *space, unsigned long state, unsigned long child[])
+{ /* successors of board state */
+  return enum_states(state, child);
+}
+
+bool external_write(FILE *file, unsigned long state, int nbytes)
+{ /* append state packed in nbytes bytes to file */
+  unsigned char bytes[sizeof(unsigned long)];
+  int i;
+  for (i = 0; i < nbytes; i++) {
+    bytes[i] = state >> (8 * i);
+  }
+  return fwrite(bytes, nbytes, 1, file) == 1;
+}
+
+bool external_read(external_reader *reader)
+{ /* read next state of reader, returns false at end of file */
+  unsigned char bytes[sizeof(unsigned long)];
+  int i;
+  if (fread(bytes, reader->nbytes, 1, reader->file) != 1) return false;
+  reader->state = 0;
+  for (i = 0; i < reader->nbytes; i++) {
+    reader->state |= (unsigned long)bytes[i] << (8 * i);
+  }
+  return true;
+}
+
+void external_layer_path(char *path, size_t size, const char *dir, int depth)
+{
+  snprintf(path, size, "%s/layer-%03d", dir, depth);
+}
+
+void external_run_path(char *path, size_t size, const char *dir, int run)
+{
+  snprintf(path, size, "%s/run-%05d", dir, run);
+}
+
+int compare_states(const void *a, const void *b)
+{
+  unsigned long x = *(const unsigned long *)a, y = *(const unsigned long *)b;
+  return (x > y) - (x < y);
+}
+
+bool external_flush(const char *dir, int run, unsigned long buffer[], long count, int nbytes)
+{ /* sort buffer, and write its distinct states as run */
+  char path[4096];
+  FILE *file;
+  long i;
+  external_run_path(path, sizeof(path), dir, run);
+  qsort(buffer, count, sizeof(unsigned long), compare_states);
+  file = fopen(path, "wb");
+  check(file, "failed to open %s", path);
+  for (i = 0; i < count; i++) {
+    if (i > 0 && buffer[i] == buffer[i - 1]) continue;
+    check(external_write(file, buffer[i], nbytes), "failed to write %s", path);
+  }
+  i = fclose(file);
+  file = NULL;
+  check(i == 0, "failed to close %s", path);
+  return true;
+ error:
+  if (file) fclose(file);
+  return false;
+}
+
+int external_expand(const external_space *space, const char *dir, int depth,
+		    unsigned long buffer[], long capacity)
+{ /* write successors of layer depth as runs 0, 1, ..., returns number of runs, -1 on error */
+  char path[4096];
+  external_reader layer = { NULL, space->nbytes, 0, depth };
+  long count = 0;
+  int i, nchildren, nruns = 0;
+  unsigned long child[EXTERNAL_CHILDREN];
+  external_layer_path(path, sizeof(path), dir, depth);
+  layer.file = fopen(path, "rb");
+  check(layer.file, "failed to open %s", path);
+  while (external_read(&layer)) {
+    if (count + EXTERNAL_CHILDREN > capacity) {
+      check(external_flush(dir, nruns++, buffer, count, space->nbytes), "failed to write run");
+      count = 0;
+    }
+    nchildren = space->successors(space, layer.state, child);
+    for (i = 0; i < nchildren; i++) {
+      buffer[count++] = child[i];
+    }
+  }
+  check(!ferror(layer.file), "failed to read %s", path);
+  fclose(layer.file);
+  layer.file = NULL;
+  if (count > 0 || nruns == 0) {
+    check(external_flush(dir, nruns++, buffer, count, space->nbytes), "failed to write run");
+  }
+  return nruns;
+ error:
+  if (layer.file) fclose(layer.file);
+  return -1;
+}
+
+void external_sift(external_reader *heap[], int n, int i)
+{ /* restore min-heap of readers by state below i */
+  while (true) {
+    int least = i, left = 2 * i + 1, right = 2 * i + 2;
+    external_reader *swap;
+    if (left < n && heap[left]->state < heap[least]->state) least = left;
+    if (right < n && heap[right]->state < heap[least]->state) least = right;
+    if (least == i) return;
+    swap = heap[i];
+    heap[i] = heap[least];
+    heap[least] = swap;
+    i = least;
+  }
+}
+
+long external_merge(const char *dir, int first, int nruns, const char *out_path, const char *minus_path,
+		    int nbytes)
+{ /* merge runs first to first + nruns - 1 into out_path, without duplicates
+     and states of minus_path (if not NULL), and delete them; returns number
+     of states written, -1 on error */
+  char path[4096];
+  external_reader readers[EXTERNAL_FANIN];
+  external_reader *heap[EXTERNAL_FANIN];
+  external_reader minus = { NULL, nbytes, 0, 0 };
+  bool minus_left = false; /* minus.state is valid */
+  FILE *out = NULL;
+  long count = 0;
+  int i, n = 0;
+  unsigned long last = 0;
+  memset(readers, 0, sizeof(readers));
+  for (i = 0; i < nruns; i++) {
+    external_run_path(path, sizeof(path), dir, first + i);
+    readers[i].file = fopen(path, "rb");
+    readers[i].nbytes = nbytes;
+    check(readers[i].file, "failed to open %s", path);
+    if (external_read(&readers[i])) heap[n++] = &readers[i];
+  }
+  for (i = n / 2 - 1; i >= 0; i--) external_sift(heap, n, i);
+  if (minus_path) {
+    minus.file = fopen(minus_path, "rb");
+    check(minus.file, "failed to open %s", minus_path);
+    minus_left = external_read(&minus);
+  }
+  out = fopen(out_path, "wb");
+  check(out, "failed to open %s", out_path);
+
+  while (n > 0) {
+    unsigned long state = heap[0]->state;
+    if (!external_read(heap[0])) heap[0] = heap[--n]; /* run is exhausted */
+    external_sift(heap, n, 0);
+    if (count > 0 && state == last) continue; /* duplicate */
+    while (minus_left && minus.state < state) minus_left = external_read(&minus);
+    if (minus_left && minus.state == state) continue; /* in layer d - 1 */
+    check(external_write(out, state, nbytes), "failed to write %s", out_path);
+    last = state;
+    count++;
+  }
+
+  for (i = 0; i < nruns; i++) {
+    check(!ferror(readers[i].file), "failed to read run %d", first + i);
+    fclose(readers[i].file);
+    readers[i].file = NULL;
+    external_run_path(path, sizeof(path), dir, first + i);
+    unlink(path);
+  }
+  if (minus.file) fclose(minus.file);
+  i = fclose(out);
+  out = NULL;
+  check(i == 0, "failed to close %s", out_path);
+  return count;
+ error:
+  for (i = 0; i < nruns; i++) {
+    if (readers[i].file) fclose(readers[i].file);
+  }
+  if (minus.file) fclose(minus.file);
+  if (out) fclose(out);
+  return -1;
+}
+
+long external_layer(const external_space *space, const char *dir, int depth,
+		    unsigned long buffer[], long capacity)
+{ /* write layer depth + 1 from layer depth (and depth - 1), returns its number of states, -1 on error */
+  char path[4096], minus_path[4096], run_path[4096], tmp_path[4200];
+  int first = 0;
+  int nruns = external_expand(space, dir, depth, buffer, capacity);
+  long count;
+  check(nruns >= 0, "failed to expand layer %d", depth);
+  while (nruns - first > EXTERNAL_FANIN) { /* merge the oldest runs into a new one */
+    external_run_path(run_path, sizeof(run_path), dir, nruns);
+    check(external_merge(dir, first, EXTERNAL_FANIN, run_path, NULL, space->nbytes) >= 0,
+	  "failed to merge runs");
+    first += EXTERNAL_FANIN;
+    nruns++;
+  }
+  external_layer_path(path, sizeof(path), dir, depth + 1);
+  external_layer_path(minus_path, sizeof(minus_path), dir, depth - 1);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  count = external_merge(dir, first, nruns - first, tmp_path, depth > 0 ? minus_path : NULL,
+			 space->nbytes);
+  check(count >= 0, "failed to merge layer %d", depth + 1);
+  if (count == 0) {
+    unlink(tmp_path);
+  } else {
+    check(rename(tmp_path, path) == 0, "failed to rename %s", tmp_path);
+  }
+  return count;
+ error:
+  return -1;
+}
+
+int external_enumerate(const external_space *space, const char *dir, unsigned long start,
+		       int max_depth, long bytes)
+{ /* enumerate layers of space around start into dir, up to max_depth if
+     >= 0, resuming after the last complete layer; returns the last layer,
+     -1 on error */
+  char path[4096];
+  long capacity = bytes / sizeof(unsigned long);
+  unsigned long *buffer = NULL;
+  struct stat st;
+  FILE *file = NULL;
+  long count = 1;
+  int depth = 0, i;
+  check(capacity >= 1024, "run memory of %ld bytes is too small", bytes);
+  check(mkdir(dir, 0755) == 0 || errno == EEXIST, "failed to create %s", dir);
+  buffer = malloc(capacity * sizeof(unsigned long));
+  check_mem(buffer);
+
+  external_layer_path(path, sizeof(path), dir, 0);
+  if (stat(path, &st) != 0) { /* new enumeration */
+    file = fopen(path, "wb");
+    check(file, "failed to open %s", path);
+    check(external_write(file, start, space->nbytes), "failed to write %s", path);
+    i = fclose(file);
+    file = NULL;
+    check(i == 0, "failed to close %s", path);
+  }
+  while (external_layer_path(path, sizeof(path), dir, depth + 1), stat(path, &st) == 0) depth++;
+  if (depth > 0) log_info("resuming after layer %d of %s", depth, dir);
+
+  while ((max_depth < 0 || depth < max_depth) && count > 0) {
+    count = external_layer(space, dir, depth, buffer, capacity);
+    check(count >= 0, "failed to enumerate layer %d", depth + 1);
+    log_info("layer %d: %ld states", depth + 1, count);
+    if (count > 0) depth++;
+  }
+  free(buffer);
+  return depth;
+ error:
+  if (file) fclose(file);
+  free(buffer);
+  return -1;
+}
+
+bool external_bfs(const char *dir, int max_depth, long bytes)
+{ /* enumerate layers of states around END_STATE into dir, up to max_depth
+     if >= 0, resuming after the last complete layer; prints number of
+     states of each layer */
+  char path[4096];
+  external_space space = { EXTERNAL_BYTES, external_board_successors, BOARD_WIDTH, BOARD_CELLS, 0 };
+  struct stat st;
+  int depth, i;
+  depth = external_enumerate(&space, dir, END_STATE, max_depth, bytes);
+  check(depth >= 0, "failed to enumerate states into %s", dir);
+  for (i = 0; i <= depth; i++) {
+    external_layer_path(path, sizeof(path), dir, i);
+    check(stat(path, &st) == 0, "failed to stat %s", path);
+    printf("%d %ld\n", i, (long)st.st_size / EXTERNAL_BYTES);
+  }
+  return true;
+ error:
+  return false;
+}
+
+bool external_table(const char *dir, int depth, size_t size, int nbytes, FILE *out)
+{ /* write the layer of each state 0 to size - 1 to out, a byte each, 0xFF
+     for states of no layer: layers 0 to depth of dir are merged by state */
+  char path[4096];
+  external_reader *readers = calloc(depth + 1, sizeof(*readers));
+  external_reader **heap = calloc(depth + 1, sizeof(*heap));
+  size_t state;
+  int i, n = 0;
+  check_mem(readers);
+  check_mem(heap);
+  check(depth < 0xFF, "%d layers do not fit in a byte", depth + 1);
+  for (i = 0; i <= depth; i++) {
+    external_layer_path(path, sizeof(path), dir, i);
+    readers[i].file = fopen(path, "rb");
+    readers[i].nbytes = nbytes;
+    readers[i].depth = i;
+    check(readers[i].file, "failed to open %s", path);
+    if (external_read(&readers[i])) heap[n++] = &readers[i];
+  }
+  for (i = n / 2 - 1; i >= 0; i--) external_sift(heap, n, i);
+
+  for (state = 0; state < size; state++) {
+    int distance = 0xFF;
+    if (n > 0 && heap[0]->state == state) {
+      distance = heap[0]->depth;
+      if (!external_read(heap[0])) heap[0] = heap[--n]; /* layer is exhausted */
+      external_sift(heap, n, 0);
+    }
+    check(fputc(distance, out) != EOF, "failed to write table of %s", dir);
+  }
+  check(n == 0, "layers of %s hold states beyond %zu", dir, size);
+
+  for (i = 0; i <= depth; i++) {
+    check(!ferror(readers[i].file), "failed to read layer %d of %s", i, dir);
+    fclose(readers[i].file);
+    readers[i].file = NULL;
+  }
+  free(readers);
+  free(heap);
+  return true;
+ error:
+  if (readers) {
+    for (i = 0; i <= depth; i++) {
+      if (readers[i].file) fclose(readers[i].file);
+    }
+  }
+  free(readers);
+  free(heap);
+  return false;
+}
+
+/********************************************
+ *    OPERATIONS FOR PATTERN DATABASES      *
+ ********************************************/
+
+/**********************************************
+ *  Disjoint additive pattern databases: the tiles are split into
+ *  groups, and for each group a table stores the least number of moves
+ *  of the group's tiles needed to bring them to their goal positions,
+ *  over all positions of the other tiles (moves of other tiles are free).
+ *  Since the groups are disjoint, the sum over groups is admissible.
+ *
+ *  A group of k tiles on a board of n cells is indexed by the rank of
+ *  the k-permutation of its tile positions, n! / (n - k)! entries of a
+ *  byte each. Tables are built by retrograde breadth-first search from
+ *  the goal positions of the group, in memory, or on disk (-x DIR) for
+ *  groups whose table and queue exceed the memory budget (-M), by
+ *  external-memory breadth-first search over the ranks of the group's
+ *  patterns, whose layers are then merged into the table.
+ *
+ *  The builder takes the board dimensions, so that it works for any board
+ *  of up to 16 cells (e.g. "4x4:1,2,3,4,5/6,7,8,9,10/11,12,13,14,15").
+ *
+ *  On a square board, a group whose tiles are the reflection (see
+ *  reflect_state) of an earlier group's has no table of its own: it is
+ *  looked up in the earlier group's table at the reflected cells, e.g.
+ *  "4x4:2,3,4,7,8,12/5,9,13,10,14,15/1,6,11" stores two tables. Unless
+ *  the groups are their own reflection that way, the heuristic is the
+ *  larger of the sums over groups of a state and of its reflection.
+ *
+ *  file format: pdb_header, followed by the table of each group that is
+ *  not the reflection of another
+ **********************************************/
+
+typedef struct pdb_header {
+  char magic[4]; /* PDB_MAGIC */
+  unsigned version; /* PDB_VERSION */
+  unsigned width; /* board dimensions */
+  unsigned height;
+  unsigned ngroups; /* number of disjoint groups */
+  unsigned ntiles[PDB_MAX_GROUPS]; /* number of tiles in each group */
+  unsigned char tiles[PDB_MAX_GROUPS][PDB_MAX_TILES]; /* tiles of each group */
+  unsigned char mirror[PDB_MAX_GROUPS]; /* group whose table serves each group,
+					   by reflection if not the group itself */
+} pdb_header;
+
+typedef struct pattern_db {
+  int width, height, ncells; /* board dimensions */
+  int ngroups;
+  int ntiles[PDB_MAX_GROUPS];
+  unsigned char tiles[PDB_MAX_GROUPS][PDB_MAX_TILES]; /* tile whose cell is each position
+							   of the table of each group */
+  unsigned char reflected_tiles[PDB_MAX_GROUPS][PDB_MAX_TILES]; /* the same, for the
+								   reflection of state */
+  bool mirrored[PDB_MAX_GROUPS]; /* group is looked up at reflected cells */
+  bool reflect; /* take larger of lookups of state and reflection */
+  const unsigned char *table[PDB_MAX_GROUPS]; /* table of each group */
+  void *map; /* memory-mapped file */
+  size_t map_size;
+} pattern_db;
+
+pattern_db pdb; /* loaded pattern database, pdb.map is NULL if not loaded */
+
+unsigned long goal_state(int ncells)
+{ /* goal of board with ncells cells: tiles in order, blank in last cell */
+  int i;
+  unsigned long state = 0;
+  for (i = 0; i < ncells - 1; i++) {
+    state |= (unsigned long)(i + 1) << (4 * i);
+  }
+  return state;
+}
+
+size_t pattern_size(int ncells, int ntiles)
+{ /* number of k-permutations of cells: n! / (n - k)! */
+  int i;
+  size_t size = 1;
+  for (i = 0; i < ntiles; i++) {
+    size *= ncells - i;
+  }
+  return size;
+}
+
+unsigned pattern_rank(const int pos[], int ntiles, int ncells)
+{ /* lexicographic rank of k-permutation of positions: each digit is the
+     position less the positions ranked before it that are lower, counted
+     by comparisons (the default build has no popcount instruction) */
+  int i, j;
+  unsigned rank = 0;
+  for (i = 0; i < ntiles; i++) {
+    int digit = pos[i];
+    for (j = 0; j < i; j++) {
+      digit -= pos[j] < pos[i];
+    }
+    rank = rank * (ncells - i) + digit;
+  }
+  return rank;
+}
+
+void pattern_unrank(unsigned rank, int pos[], int ntiles, int ncells)
+{ /* inverse of pattern_rank */
+  int i, j;
+  unsigned used = 0;
+  for (i = ntiles - 1; i >= 0; i--) { /* extract digits, least significant first */
+    pos[i] = rank % (ncells - i);
+    rank /= ncells - i;
+  }
+  for (i = 0; i < ntiles; i++) { /* digit is index among unused positions */
+    for (j = 0; pos[i] >= 0; j++) {
+      if (!(used & (1u << j))) pos[i]--;
+    }
+    pos[i] = j - 1;
+    used |= 1u << pos[i];
+  }
+}
+
+int pattern_successors(unsigned rank, int width, int ncells, int ntiles, unsigned long next[])
+{ /* ranks of patterns reached from pattern of rank by moving a tile of the
+     group to an adjacent cell, returns their number. the blank is abstracted
+     away: a tile moves to any adjacent cell not occupied by the group,
+     which keeps the heuristic consistent */
+  int pos[PDB_MAX_TILES];
+  unsigned occupied = 0; /* bitset of cells occupied by group */
+  int i, j, n = 0;
+  pattern_unrank(rank, pos, ntiles, ncells);
+  for (i = 0; i < ntiles; i++) {
+    occupied |= 1u << pos[i];
+  }
+  for (i = 0; i < ntiles; i++) {
+    int cell = pos[i];
+    int moves[4] = { cell - width, cell + width, cell - 1, cell + 1 };
+    for (j = 0; j < 4; j++) {
+      if (moves[j] < 0 || moves[j] >= ncells ||
+	  (j >= 2 && moves[j] / width != cell / width)) continue; /* off the board */
+      if (occupied & (1u << moves[j])) continue;
+      pos[i] = moves[j];
+      next[n++] = pattern_rank(pos, ntiles, ncells);
+      pos[i] = cell;
+    }
+  }
+  return n;
+}
+
+unsigned char *pdb_build_group(int width, int height, const unsigned char tiles[], int ntiles)
+{ /* retrograde breadth-first search for one group in memory, returns its table */
+  int ncells = width * height;
+  size_t size = pattern_size(ncells, ntiles);
+  unsigned char *table = malloc(size); /* distance of pattern rank, 0xFF if unseen */
+  unsigned *queue = malloc(size * sizeof(*queue)); /* pattern ranks in order of distance */
+  int pos[PDB_MAX_TILES];
+  size_t head = 0, tail = 0;
+  int i;
+  check_mem(table);
+  check_mem(queue);
+  memset(table, 0xFF, size);
+
+  for (i = 0; i < ntiles; i++) {
+    pos[i] = tiles[i] - 1; /* goal position of tile */
+  }
+  queue[tail] = pattern_rank(pos, ntiles, ncells);
+  table[queue[tail++]] = 0;
+
+  while (head < tail) {
+    unsigned rank = queue[head++];
+    unsigned long next[4 * PDB_MAX_TILES];
+    int nnext = pattern_successors(rank, width, ncells, ntiles, next);
+    for (i = 0; i < nnext; i++) {
+      if (table[next[i]] != 0xFF) continue;
+      table[next[i]] = table[rank] + 1;
+      queue[tail++] = next[i];
+    }
+  }
+  free(queue);
+  return table;
+ error:
+  free(table);
+  free(queue);
+  return NULL;
+}
+
+int pdb_external_successors(const external_space *space, unsigned long rank, unsigned long child[])
+{ /* successors of pattern of rank, for external_enumerate */
+  return pattern_successors(rank, space->width, space->ncells, space->ntiles, child);
+}
+
+bool pdb_build_external(const char *dir, int g, int width, int height,
+			const unsigned char tiles[], int ntiles, long bytes, FILE *out)
+{ /* breadth-first search for group g on disk, in dir/group-g with runs of
+     bytes of memory, and write its table to out */
+  char path[4096];
+  external_space space = { 1, pdb_external_successors, width, width * height, ntiles };
+  size_t size = pattern_size(width * height, ntiles);
+  int pos[PDB_MAX_TILES];
+  int i, depth;
+  while ((size - 1) >> (8 * space.nbytes)) space.nbytes++; /* bytes of largest rank */
+  for (i = 0; i < ntiles; i++) {
+    pos[i] = tiles[i] - 1; /* goal position of tile */
+  }
+  check(mkdir(dir, 0755) == 0 || errno == EEXIST, "failed to create %s", dir);
+  snprintf(path, sizeof(path), "%s/group-%d", dir, g);
+  depth = external_enumerate(&space, path, pattern_rank(pos, ntiles, width * height), -1, bytes);
+  check(depth >= 0, "failed to enumerate patterns of group %d", g);
+  check(external_table(path, depth, size, space.nbytes, out), "failed to write table of group %d", g);
+  return true;
+ error:
+  return false;
+}
+
+unsigned pdb_reflected_tiles(const pdb_header *header, int g)
+{ /* bitset of reflections of tiles of group g, 0 if the board is not square */
+  unsigned reflected = 0;
+  int i, cell;
+  if (header->width != header->height) return 0;
+  for (i = 0; i < (int)header->ntiles[g]; i++) {
+    cell = header->tiles[g][i] - 1; /* goal cell of tile */
+    reflected |= 1u << (cell % header->width * header->width + cell / header->width + 1);
+  }
+  return reflected;
+}
+
+bool pdb_parse(const char *spec, pdb_header *header)
+{ /* parse "WxH:tiles/tiles/..." into header, e.g. "3x3:1,2,3,4/5,6,7,8" */
+  int n, tile;
+  unsigned seen = 0; /* bitset of tiles in groups */
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, PDB_MAGIC, 4);
+  header->version = PDB_VERSION;
+
+  check(sscanf(spec, "%ux%u:%n", &header->width, &header->height, &n) == 2,
+	"invalid pattern database %s", spec);
+  check(header->width >= 2 && header->height >= 2 && header->width * header->height <= 16,
+	"invalid board dimensions in %s", spec);
+  spec += n;
+  header->ngroups = 1;
+  while (*spec) {
+    if (*spec == '/') {
+      check(header->ngroups < PDB_MAX_GROUPS, "too many groups in pattern database");
+      header->ngroups++;
+      spec++;
+      continue;
+    }
+    if (*spec == ',') {
+      spec++;
+      continue;
+    }
+    check(sscanf(spec, "%d%n", &tile, &n) == 1, "invalid tile in pattern database");
+    check(tile > 0 && tile < (int)(header->width * header->height) && !(seen & (1u << tile)),
+	  "invalid tile %d in pattern database", tile);
+    check(header->ntiles[header->ngroups - 1] < PDB_MAX_TILES, "too many tiles in group");
+    header->tiles[header->ngroups - 1][header->ntiles[header->ngroups - 1]++] = tile;
+    seen |= 1u << tile;
+    spec += n;
+  }
+  for (n = 0; n < (int)header->ngroups; n++) {
+    unsigned reflected = pdb_reflected_tiles(header, n);
+    int g, i;
+    check(header->ntiles[n] > 0, "empty group in pattern database");
+    header->mirror[n] = n;
+    for (g = 0; g < n; g++) { /* earlier group of the reflected tiles */
+      unsigned tiles = 0;
+      for (i = 0; i < (int)header->ntiles[g]; i++) {
+	tiles |= 1u << header->tiles[g][i];
+      }
+      if (tiles == reflected && header->mirror[g] == g) header->mirror[n] = g;
+    }
+  }
+  return true;
+ error:
+  return false;
+}
+
+bool pdb_build(const char *path, const char *spec, const char *dir, long bytes)
+{ /* build pattern database given by spec, and save to path; with dir, groups
+     whose search needs more than bytes of memory are searched on disk in dir */
+  pdb_header header;
+  unsigned char *table = NULL;
+  FILE *file = NULL;
+  int g;
+  check(pdb_parse(spec, &header), "failed to parse pattern database");
+
+  file = fopen(path, "wb");
+  check(file, "failed to open %s", path);
+  check(fwrite(&header, sizeof(header), 1, file) == 1, "failed to write %s", path);
+  for (g = 0; g < (int)header.ngroups; g++) {
+    size_t size = pattern_size(header.width * header.height, header.ntiles[g]);
+    if (header.mirror[g] != g) {
+      log_info("group %d is the reflection of group %d", g, header.mirror[g]);
+      continue;
+    }
+    if (dir && size * (1 + sizeof(unsigned)) > (size_t)bytes) { /* table and queue */
+      check(pdb_build_external(dir, g, header.width, header.height, header.tiles[g], header.ntiles[g],
+			       bytes, file), "failed to build group %d", g);
+      log_info("built group %d on disk: %zu entries", g, size);
+      continue;
+    }
+    table = pdb_build_group(header.width, header.height, header.tiles[g], header.ntiles[g]);
+    check(table, "failed to build group %d", g);
+    check(fwrite(table, size, 1, file) == 1, "failed to write %s", path);
+    log_info("built group %d: %zu entries", g, size);
+    free(table);
+    table = NULL;
+  }
+  check(fclose(file) == 0, "failed to close %s", path);
+  return true;
+ error:
+  if (file) fclose(file);
+  free(table);
+  return false;
+}
+
+bool pdb_load(const char *path)
+{ /* memory-map pattern database read-only, so that processes share the tables */
+  struct stat st;
+  const pdb_header *header;
+  const unsigned char *table;
+  unsigned tiles[PDB_MAX_GROUPS]; /* bitset of tiles of each group */
+  unsigned used = 0; /* bitset of tiles of all groups */
+  size_t size = sizeof(pdb_header);
+  int g, h, i;
+  int fd = open(path, O_RDONLY);
+  check(fd >= 0, "failed to open %s", path);
+  check(fstat(fd, &st) == 0, "failed to stat %s", path);
+  check((size_t)st.st_size >= sizeof(pdb_header), "invalid size of %s", path);
+
+  pdb.map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  check(pdb.map != MAP_FAILED, "failed to map %s", path);
+  close(fd);
+  fd = -1;
+  pdb.map_size = st.st_size;
+
+  header = pdb.map;
+  check(memcmp(header->magic, PDB_MAGIC, 4) == 0 && header->version == PDB_VERSION &&
+	header->ngroups <= PDB_MAX_GROUPS, "invalid header in %s", path);
+  check(header->width == BOARD_WIDTH && header->height == BOARD_HEIGHT,
+	"pattern database %s is for a %ux%u board",
+	path, header->width, header->height);
+
+  pdb.width = header->width;
+  pdb.height = header->height;
+  pdb.ncells = header->width * header->height;
+  pdb.ngroups = header->ngroups;
+  for (g = 0; g < pdb.ngroups; g++) { /* tiles are used as shifts and indices below */
+    check(header->ntiles[g] <= PDB_MAX_TILES, "invalid header in %s", path);
+    for (i = 0; i < (int)header->ntiles[g]; i++) {
+      unsigned tile = header->tiles[g][i];
+      check(tile >= 1 && tile < (unsigned)pdb.ncells && !(used & (1u << tile)),
+	    "invalid tile %u in header of %s", tile, path);
+      used |= 1u << tile;
+    }
+  }
+  table = (const unsigned char *)(header + 1);
+  for (g = 0; g < pdb.ngroups; g++) {
+    int mirror = header->mirror[g];
+    pdb.ntiles[g] = header->ntiles[g];
+    check(mirror <= g && header->mirror[mirror] == mirror &&
+	  header->ntiles[mirror] == header->ntiles[g], "invalid header in %s", path);
+    pdb.mirrored[g] = mirror != g;
+    tiles[g] = 0;
+    for (i = 0; i < pdb.ntiles[g]; i++) {
+      tiles[g] |= 1u << header->tiles[g][i];
+    }
+    for (i = 0; i < pdb.ntiles[g]; i++) { /* a state and its reflection trade the tiles
+					     of the table and their reflections */
+      int tile = header->tiles[mirror][i];
+      check(tiles[g] & (1u << (pdb.mirrored[g] ? reflect_tile[tile] : tile)),
+	    "invalid header in %s", path);
+      pdb.tiles[g][i] = pdb.mirrored[g] ? reflect_tile[tile] : tile;
+      pdb.reflected_tiles[g][i] = pdb.mirrored[g] ? tile : reflect_tile[tile];
+    }
+    if (pdb.mirrored[g]) {
+      pdb.table[g] = pdb.table[mirror];
+      continue;
+    }
+    pdb.table[g] = table;
+    table += pattern_size(pdb.ncells, pdb.ntiles[g]);
+    size += pattern_size(pdb.ncells, pdb.ntiles[g]);
+  }
+  check(size == (size_t)st.st_size, "invalid size of %s", path);
+
+  pdb.reflect = false; /* unless the reflection of each group is a group */
+  for (g = 0; g < pdb.ngroups && BOARD_SYMMETRIC; g++) {
+    unsigned reflected = pdb_reflected_tiles(header, g);
+    for (h = 0; h < pdb.ngroups && tiles[h] != reflected; h++);
+    if (h == pdb.ngroups) pdb.reflect = true;
+  }
+  return true;
+ error:
+  if (fd >= 0) close(fd);
+  if (pdb.map && pdb.map != MAP_FAILED) munmap(pdb.map, st.st_size);
+  pdb.map = NULL;
+  return false;
+}
+
+void pdb_free(void)
+{ /* unmap pattern database */
+  if (pdb.map) munmap(pdb.map, pdb.map_size);
+  pdb.map = NULL;
+}
+
+int pdb_heuristic(unsigned long state, int nmoves)
+{ /* f_score = sum of pattern database entries of all groups, the larger of
+     that of state and its reflection, + number of moves made */
+  unsigned char cell[16]; /* cell of each tile */
+  int pos[PDB_MAX_TILES];
+  int i, g;
+  int distance = 0, reflected_distance = 0;
+  for (i = 0; i < pdb.ncells; i++) {
+    cell[(state >> (4 * i)) & 0xF] = i;
+  }
+  for (g = 0; g < pdb.ngroups; g++) { /* the reflection of state is at reflected cells */
+    for (i = 0; i < pdb.ntiles[g]; i++) {
+      pos[i] = cell[pdb.tiles[g][i]];
+      if (pdb.mirrored[g]) pos[i] = reflect_cell[pos[i]];
+    }
+    distance += pdb.table[g][pattern_rank(pos, pdb.ntiles[g], pdb.ncells)];
+  }
+  if (pdb.reflect) {
+    for (g = 0; g < pdb.ngroups; g++) {
+      for (i = 0; i < pdb.ntiles[g]; i++) {
+	pos[i] = cell[pdb.reflected_tiles[g][i]];
+	if (!pdb.mirrored[g]) pos[i] = reflect_cell[pos[i]];
+      }
+      reflected_distance += pdb.table[g][pattern_rank(pos, pdb.ntiles[g], pdb.ncells)];
+    }
+    if (reflected_distance > distance) distance = reflected_distance;
+  }
+  return distance + nmoves;
+}
+
+/********************************************
+ *       OPERATIONS FOR A* SEARCH           *
+ ********************************************/
+
+int no_heuristic(unsigned long state, int nmoves)
+{ /* f_score = number of moves made */
+  return nmoves;
+}
+
+unsigned char manhattan[16][BOARD_CELLS]; /* manhattan distance of tile at index, by tile and index */
+
+void manhattan_table_init(unsigned char table[][BOARD_CELLS], unsigned long target)
+{ /* precompute manhattan distance of every tile at every index to its index in target */
+  int tile, i, goal;
+  for (tile = 1; tile < BOARD_CELLS; tile++) {
+    goal = 0;
+    while (((target >> (4 * goal)) & 0xF) != (unsigned long)tile) goal++; /* tile index for target */
+    for (i = 0; i < BOARD_CELLS; i++) {
+      table[tile][i] = abs(i / BOARD_WIDTH - goal / BOARD_WIDTH) + abs(i % BOARD_WIDTH - goal % BOARD_WIDTH);
+    }
+  }
+}
+
+int manhattan_table_distance(const unsigned char table[][BOARD_CELLS], unsigned long state)
+{ /* manhattan distance of state to target of table */
+  int i;
+  int distance = 0;
+  for (i = 0; i < BOARD_CELLS; i++) {
+    distance += table[(state >> (4 * i)) & 0xF][i];
+  }
+  return distance;
+}
+
+int manhattan_table_delta(const unsigned char table[][BOARD_CELLS], unsigned long state, unsigned long child)
+{ /* change in manhattan distance to target of table from state to child state:
+     the two states differ in a single tile, swapped with the blank */
+  unsigned long diff = state ^ child; /* tile in the two differing indices */
+  int low = __builtin_ctzl(diff) / 4;
+  int high = (63 - __builtin_clzl(diff)) / 4;
+  int tile = (diff >> (4 * low)) & 0xF;
+  if (((state >> (4 * low)) & 0xF) == 0) { /* tile moves from high to low index */
+    return table[tile][low] - table[tile][high];
+  }
+  return table[tile][high] - table[tile][low];
+}
+
+void manhattan_init(void)
+{ /* precompute manhattan distance of every tile at every index to its index in END_STATE */
+  manhattan_table_init(manhattan, END_STATE);
+}
+
+/**********************************************
+ *  Vector kernels: the nibbles of a state are unpacked into one byte
+ *  per cell, so that all cells are scored at once. Misplaced tiles are
+ *  counted by comparing with the goal and a popcount of the mask;
+ *  manhattan distance looks up the goal row and column of each tile by
+ *  byte shuffle, and sums absolute differences to the row and column of
+ *  its cell. The AVX2 kernels score two children per register, the
+ *  SSSE3 ones a single state; kernels_init picks them by the features
+ *  of the CPU, and the scalar kernels serve everywhere else.
+ **********************************************/
+
+int misplaced_scalar(unsigned long state)
+{ /* number of tiles (not blank) out of their place in END_STATE */
+  unsigned long nibbles = 0x1111111111111111UL;
+  unsigned long diff = state ^ END_STATE;
+  diff = (diff | diff >> 1 | diff >> 2 | diff >> 3) & nibbles; /* lowest bit of cells that differ */
+  state = (state | state >> 1 | state >> 2 | state >> 3) & nibbles; /* lowest bit of tiles */
+  return __builtin_popcountl(diff & state);
+}
+
+int manhattan_scalar(unsigned long state)
+{ /* manhattan distance of state to END_STATE */
+  return manhattan_table_distance(manhattan, state);
+}
+
+void misplaced_children_scalar(const unsigned long child[], int nchildren, int h[])
+{
+  int i;
+  for (i = 0; i < nchildren; i++) h[i] = misplaced_scalar(child[i]);
+}
+
+void manhattan_children_scalar(const unsigned long child[], int nchildren, int h[])
+{
+  int i;
+  for (i = 0; i < nchildren; i++) h[i] = manhattan_scalar(child[i]);
+}
+
+int (*misplaced_kernel)(unsigned long state) = misplaced_scalar;
+int (*manhattan_kernel)(unsigned long state) = manhattan_scalar;
+void (*misplaced_children_kernel)(const unsigned long child[], int nchildren, int h[]) = misplaced_children_scalar;
+void (*manhattan_children_kernel)(const unsigned long child[], int nchildren, int h[]) = manhattan_children_scalar;
+
+#if defined(__x86_64__)
+unsigned char kernel_goal_tile[16] __attribute__((aligned(16))); /* tile by cell of END_STATE, 0 past the board */
+unsigned char kernel_goal_row[16] __attribute__((aligned(16))); /* row of tile in END_STATE, by tile */
+unsigned char kernel_goal_col[16] __attribute__((aligned(16))); /* column of tile in END_STATE, by tile */
+unsigned char kernel_cell_row[16] __attribute__((aligned(16))); /* row of cell */
+unsigned char kernel_cell_col[16] __attribute__((aligned(16))); /* column of cell */
+
+__attribute__((target("ssse3")))
+static inline __m128i kernel_unpack(unsigned long state)
+{ /* byte i = nibble i of state */
+  __m128i packed = _mm_cvtsi64_si128(state);
+  __m128i low = _mm_and_si128(packed, _mm_set1_epi8(0xF));
+  __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), _mm_set1_epi8(0xF));
+  return _mm_unpacklo_epi8(low, high);
+}
+
+__attribute__((target("ssse3")))
+int misplaced_ssse3(unsigned long state)
+{
+  __m128i tiles = kernel_unpack(state);
+  __m128i goal = _mm_load_si128((const __m128i *)kernel_goal_tile);
+  unsigned same = _mm_movemask_epi8(_mm_cmpeq_epi8(tiles, goal)) |
+    _mm_movemask_epi8(_mm_cmpeq_epi8(tiles, _mm_setzero_si128())); /* in place, or blank */
+  return __builtin_popcount(~same & 0xFFFF);
+}
+
+__attribute__((target("ssse3")))
+int manhattan_ssse3(unsigned long state)
+{
+  __m128i tiles = kernel_unpack(state);
+  __m128i rows = _mm_shuffle_epi8(_mm_load_si128((const __m128i *)kernel_goal_row), tiles);
+  __m128i cols = _mm_shuffle_epi8(_mm_load_si128((const __m128i *)kernel_goal_col), tiles);
+  __m128i distance = _mm_add_epi8(
+    _mm_abs_epi8(_mm_sub_epi8(rows, _mm_load_si128((const __m128i *)kernel_cell_row))),
+    _mm_abs_epi8(_mm_sub_epi8(cols, _mm_load_si128((const __m128i *)kernel_cell_col))));
+  __m128i sum;
+  distance = _mm_andnot_si128(_mm_cmpeq_epi8(tiles, _mm_setzero_si128()), distance); /* blank scores 0 */
+  sum = _mm_sad_epu8(distance, _mm_setzero_si128());
+  return _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+}
+
+void misplaced_children_ssse3(const unsigned long child[], int nchildren, int h[])
+{
+  int i;
+  for (i = 0; i < nchildren; i++) h[i] = misplaced_ssse3(child[i]);
+}
+
+void manhattan_children_ssse3(const unsigned long child[], int nchildren, int h[])
+{
+  int i;
+  for (i = 0; i < nchildren; i++) h[i] = manhattan_ssse3(child[i]);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i kernel_unpack2(unsigned long first, unsigned long second)
+{ /* first state in low lane, second in high lane, a byte per nibble */
+  return _mm256_set_m128i(kernel_unpack(second), kernel_unpack(first));
+}
+
+__attribute__((target("avx2")))
+void misplaced_children_avx2(const unsigned long child[], int nchildren, int h[])
+{
+  __m256i goal = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)kernel_goal_tile));
+  int i;
+  for (i = 0; i < nchildren; i += 2) {
+    __m256i tiles = kernel_unpack2(child[i], child[i + 1 < nchildren ? i + 1 : i]);
+    unsigned same = _mm256_movemask_epi8(_mm256_cmpeq_epi8(tiles, goal)) |
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(tiles, _mm256_setzero_si256()));
+    h[i] = __builtin_popcount(~same & 0xFFFF);
+    if (i + 1 < nchildren) h[i + 1] = __builtin_popcount(~same >> 16);
+  }
+}
+
+__attribute__((target("avx2")))
+void manhattan_children_avx2(const unsigned long child[], int nchildren, int h[])
+{
+  __m256i goal_row = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)kernel_goal_row));
+  __m256i goal_col = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)kernel_goal_col));
+  __m256i cell_row = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)kernel_cell_row));
+  __m256i cell_col = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)kernel_cell_col));
+  int i;
+  for (i = 0; i < nchildren; i += 2) {
+    __m256i tiles = kernel_unpack2(child[i], child[i + 1 < nchildren ? i + 1 : i]);
+    __m256i distance = _mm256_add_epi8(
+      _mm256_abs_epi8(_mm256_sub_epi8(_mm256_shuffle_epi8(goal_row, tiles), cell_row)),
+      _mm256_abs_epi8(_mm256_sub_epi8(_mm256_shuffle_epi8(goal_col, tiles), cell_col)));
+    __m256i sum;
+    distance = _mm256_andnot_si256(_mm256_cmpeq_epi8(tiles, _mm256_setzero_si256()), distance);
+    sum = _mm256_sad_epu8(distance, _mm256_setzero_si256()); /* 4 sums of 8 cells */
+    h[i] = _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1);
+    if (i + 1 < nchildren) h[i + 1] = _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+  }
+}
+#endif
+
+void kernels_init(void)
+{ /* select vector kernels supported by the CPU */
+#if defined(__x86_64__)
+  int i;
+  for (i = 0; i < 16; i++) {
+    kernel_goal_tile[i] = i < BOARD_CELLS ? (END_STATE >> (4 * i)) & 0xF : 0;
+    kernel_cell_row[i] = i / BOARD_WIDTH;
+    kernel_cell_col[i] = i % BOARD_WIDTH;
+  }
+  for (i = 0; i < BOARD_CELLS; i++) {
+    unsigned tile = (END_STATE >> (4 * i)) & 0xF;
+    kernel_goal_row[tile] = i / BOARD_WIDTH;
+    kernel_goal_col[tile] = i % BOARD_WIDTH;
+  }
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    misplaced_kernel = misplaced_ssse3;
+    manhattan_kernel = manhattan_ssse3;
+    misplaced_children_kernel = misplaced_children_ssse3;
+    manhattan_children_kernel = manhattan_children_ssse3;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    misplaced_children_kernel = misplaced_children_avx2;
+    manhattan_children_kernel = manhattan_children_avx2;
+  }
+#endif
+}
+
+int misplaced_tile_heuristic(unsigned long state, int nmoves)
+{ /* f_score = number of misplaced tiles (blank excluded) + number of moves made */
+  return misplaced_kernel(state) + nmoves;
+}
+
+int manhattan_distance_heuristic(unsigned long state, int nmoves)
+{ /* f_score =  manhattan distance + nmoves */
+  return manhattan_kernel(state) + nmoves;
+}
+
+int manhattan_distance_delta(unsigned long state, unsigned long child)
+{ /* change in manhattan distance from state to child state */
+  return manhattan_table_delta(manhattan, state, child);
+}
+
+int child_h_score(int (*heuristic)(unsigned long state, int nmoves),
+		  unsigned long state, int h_score, unsigned long child)
+{ /* heuristic value of child of state, whose heuristic value is h_score;
+     manhattan distance is updated for the single tile moved */
+  if (heuristic == manhattan_distance_heuristic) {
+    return h_score + manhattan_distance_delta(state, child);
+  }
+  return heuristic(child, 0);
+}
+
+/**********************************************
+ *  Linear conflicts: two tiles in their goal line (row or column)
+ *  in reversed order must get out of each other's way, adding 2 moves
+ *  for each tile that has to leave the line on top of manhattan distance.
+ *  Each line of up to 4 tiles is a key of 4 bits per tile into a
+ *  precomputed table.
+ **********************************************/
+
+#define ROW_KEYS (1 << (4 * BOARD_WIDTH)) /* keys of a row */
+#define COLUMN_KEYS (1 << (4 * BOARD_HEIGHT)) /* keys of a column */
+
+unsigned char conflict_row[BOARD_HEIGHT][ROW_KEYS]; /* linear conflicts of row, by row index and key */
+unsigned char conflict_col[BOARD_WIDTH][COLUMN_KEYS]; /* linear conflicts of column, by column index and key */
+
+int line_conflicts(const int goal[], int n)
+{ /* 2 * number of tiles to remove from line, so that the goal positions
+     of the rest are increasing (n - longest increasing subsequence) */
+  int i, j;
+  int length[4];
+  int longest = 0;
+  for (i = 0; i < n; i++) {
+    length[i] = 1;
+    for (j = 0; j < i; j++) {
+      if (goal[j] < goal[i] && length[j] + 1 > length[i]) length[i] = length[j] + 1;
+    }
+    if (length[i] > longest) longest = length[i];
+  }
+  return 2 * (n - longest);
+}
+
+void linear_conflict_init(void)
+{ /* precompute linear conflicts of every line: key holds tiles of line in
+     increasing index, 4 bits each */
+  int line, key, i, n;
+  int goal[4]; /* goal position within line, of tiles whose goal is in line */
+  for (line = 0; line < BOARD_HEIGHT; line++) {
+    for (key = 0; key < ROW_KEYS; key++) {
+      n = 0;
+      for (i = 0; i < BOARD_WIDTH; i++) {
+	int tile = (key >> (4 * i)) & 0xF;
+	if (tile != 0 && tile < BOARD_CELLS && (tile - 1) / BOARD_WIDTH == line) goal[n++] = (tile - 1) % BOARD_WIDTH;
+      }
+      conflict_row[line][key] = line_conflicts(goal, n);
+    }
+  }
+  for (line = 0; line < BOARD_WIDTH; line++) {
+    for (key = 0; key < COLUMN_KEYS; key++) {
+      n = 0;
+      for (i = 0; i < BOARD_HEIGHT; i++) {
+	int tile = (key >> (4 * i)) & 0xF;
+	if (tile != 0 && tile < BOARD_CELLS && (tile - 1) % BOARD_WIDTH == line) goal[n++] = (tile - 1) / BOARD_WIDTH;
+      }
+      conflict_col[line][key] = line_conflicts(goal, n);
+    }
+  }
+}
+
+int row_key(unsigned long state, int row)
+{ /* tiles of row, 4 bits each, in increasing index */
+  return (state >> (4 * BOARD_WIDTH * row)) & (ROW_KEYS - 1);
+}
+
+int column_key(unsigned long state, int col)
+{ /* tiles of column, 4 bits each, in increasing index */
+  int i;
+  int key = 0;
+  for (i = 0; i < BOARD_HEIGHT; i++) {
+    key |= ((state >> (4 * (col + BOARD_WIDTH * i))) & 0xF) << (4 * i);
+  }
+  return key;
+}
+
+int linear_conflicts(unsigned long state)
+{ /* moves added by linear conflicts of all rows and columns */
+  int line;
+  int conflicts = 0;
+  for (line = 0; line < BOARD_HEIGHT; line++) {
+    conflicts += conflict_row[line][row_key(state, line)];
+  }
+  for (line = 0; line < BOARD_WIDTH; line++) {
+    conflicts += conflict_col[line][column_key(state, line)];
+  }
+  return conflicts;
+}
+
+int linear_conflict_heuristic(unsigned long state, int nmoves)
+{ /* f_score = manhattan distance + linear conflicts + nmoves */
+  return manhattan_distance_heuristic(state, nmoves) + linear_conflicts(state);
+}
+
+#if BOARD_WIDTH == BOARD_HEIGHT
+/**********************************************
+ *  Walking distance (Takahashi): count matrix whose entry (i, j) is the
+ *  number of tiles in row i whose goal is row j. A move of the blank to
+ *  an adjacent row carries one tile across, and the least number of such
+ *  moves to reach the goal matrix is a lower bound on vertical moves.
+ *  The same table, applied to columns, bounds horizontal moves, so the
+ *  board must be square.
+ *
+ *  A line of a board of side n holds n tiles, or n - 1 tiles and the blank,
+ *  so its counts take one of WALKING_IDS values, and a matrix is a key of
+ *  n line ids of WALKING_BITS bits (the blank is in the line with n - 1
+ *  tiles): 16 ids and 12-bit keys on 3x3, 55 ids and 24-bit keys on 4x4.
+ **********************************************/
+
+#define WALKING_SIDE BOARD_WIDTH
+#if WALKING_SIDE == 2
+#define WALKING_BITS 3
+#elif WALKING_SIDE == 3
+#define WALKING_BITS 4
+#else
+#define WALKING_BITS 6
+#endif
+#define WALKING_IDS (1 << WALKING_BITS)
+#define WALKING_KEYS (1 << (WALKING_BITS * WALKING_SIDE))
+#define WALKING_COUNTS (WALKING_SIDE == 2 ? 9 : WALKING_SIDE == 3 ? 64 : 625) /* (n + 1)^n */
+
+unsigned char walking[WALKING_KEYS]; /* walking distance by matrix key, 0xFF if unreachable */
+unsigned char walking_row[ROW_KEYS]; /* line id of row, by row key */
+unsigned char walking_col[COLUMN_KEYS]; /* line id of column, by column key */
+unsigned char walking_id[WALKING_COUNTS]; /* line id of counts, indexed in base n + 1 */
+unsigned char walking_counts[WALKING_IDS][WALKING_SIDE]; /* counts of line id */
+
+int walking_counts_index(const int counts[])
+{ /* index of counts of a line into walking_id */
+  int i;
+  int index = 0;
+  for (i = WALKING_SIDE - 1; i >= 0; i--) {
+    index = index * (WALKING_SIDE + 1) + counts[i];
+  }
+  return index;
+}
+
+int walking_key(int counts[][WALKING_SIDE])
+{ /* key of count matrix */
+  int line;
+  int key = 0;
+  for (line = 0; line < WALKING_SIDE; line++) {
+    key |= walking_id[walking_counts_index(counts[line])] << (WALKING_BITS * line);
+  }
+  return key;
+}
+
+void walking_distance_init(void)
+{ /* enumerate line ids, and breadth-first search from the goal matrix */
+  int i, j, key, index, n = 0;
+  int counts[WALKING_SIDE][WALKING_SIDE];
+  int *queue = NULL; /* keys in order of distance, grown on demand */
+  int head = 0, tail = 0, capacity = 0;
+  for (index = 0; index < WALKING_COUNTS; index++) {
+    int sum = 0;
+    for (i = 0, key = index; i < WALKING_SIDE; i++, key /= WALKING_SIDE + 1) {
+      counts[0][i] = key % (WALKING_SIDE + 1);
+      sum += counts[0][i];
+    }
+    if (sum == WALKING_SIDE || sum == WALKING_SIDE - 1) {
+      walking_id[index] = n;
+      for (i = 0; i < WALKING_SIDE; i++) walking_counts[n][i] = counts[0][i];
+      n++;
+    }
+  }
+  for (key = 0; key < ROW_KEYS; key++) { /* line id of row/column, by goal row/column of its tiles */
+    int row[WALKING_SIDE] = { 0 }, col[WALKING_SIDE] = { 0 };
+    for (i = 0; i < WALKING_SIDE; i++) {
+      int tile = (key >> (4 * i)) & 0xF;
+      if (tile != 0 && tile < BOARD_CELLS) {
+	row[(tile - 1) / WALKING_SIDE]++;
+	col[(tile - 1) % WALKING_SIDE]++;
+      }
+    }
+    walking_row[key] = walking_id[walking_counts_index(row)];
+    walking_col[key] = walking_id[walking_counts_index(col)];
+  }
+
+  memset(walking, 0xFF, sizeof(walking));
+  memset(counts, 0, sizeof(counts));
+  for (i = 0; i < WALKING_SIDE; i++) { /* goal: tiles of each line in it, blank in the last */
+    counts[i][i] = i < WALKING_SIDE - 1 ? WALKING_SIDE : WALKING_SIDE - 1;
+  }
+  key = walking_key(counts);
+  walking[key] = 0;
+  capacity = 1024;
+  queue = malloc(capacity * sizeof(*queue));
+  check_mem(queue);
+  queue[tail++] = key;
+  while (head < tail) {
+    int blank = 0;
+    if (capacity - tail < 2 * WALKING_SIDE) { /* room for children of key */
+      int *grown = realloc(queue, 2 * capacity * sizeof(*queue));
+      check_mem(grown);
+      queue = grown;
+      capacity *= 2;
+    }
+    key = queue[head++];
+    for (i = 0; i < WALKING_SIDE; i++) {
+      int sum = 0;
+      for (j = 0; j < WALKING_SIDE; j++) {
+	counts[i][j] = walking_counts[(key >> (WALKING_BITS * i)) & (WALKING_IDS - 1)][j];
+	sum += counts[i][j];
+      }
+      if (sum == WALKING_SIDE - 1) blank = i;
+    }
+    for (i = blank - 1; i <= blank + 1; i += 2) { /* carry a tile from adjacent line into blank line */
+      if (i < 0 || i >= WALKING_SIDE) continue;
+      for (j = 0; j < WALKING_SIDE; j++) {
+	int next;
+	if (counts[i][j] == 0) continue;
+	counts[i][j]--;
+	counts[blank][j]++;
+	next = walking_key(counts);
+	counts[i][j]++;
+	counts[blank][j]--;
+	if (walking[next] != 0xFF) continue;
+	walking[next] = walking[key] + 1;
+	queue[tail++] = next;
+      }
+    }
+  }
+  free(queue);
+  return;
+ error:
+  free(queue);
+}
+int walking_distance_heuristic(unsigned long state, int nmoves)
+{ /* f_score = vertical + horizontal walking distance + nmoves */
+  int line;
+  int rows = 0, cols = 0;
+  for (line = 0; line < WALKING_SIDE; line++) {
+    rows |= walking_row[row_key(state, line)] << (WALKING_BITS * line);
+    cols |= walking_col[column_key(state, line)] << (WALKING_BITS * line);
+  }
+  return walking[rows] + walking[cols] + nmoves;
+}
+#endif
+
+typedef struct heuristic_entry {
+  const char *name;
+  int (*function)(unsigned long state, int nmoves);
+} heuristic_entry;
+
+heuristic_entry heuristics[] = {
+  { "none", no_heuristic },
+  { "misplaced", misplaced_tile_heuristic },
+  { "manhattan", manhattan_distance_heuristic },
+  { "linear", linear_conflict_heuristic },
+#if BOARD_WIDTH == BOARD_HEIGHT
+  { "walking", walking_distance_heuristic },
+#endif
+  { "oracle", oracle_heuristic },
+  { "pdb", pdb_heuristic },
+  { NULL, NULL }
+};
+
+void heuristics_init(void)
+{ /* precompute tables of heuristics, and select kernels */
+  manhattan_init();
+  kernels_init();
+  linear_conflict_init();
+#if BOARD_WIDTH == BOARD_HEIGHT
+  walking_distance_init();
+#endif
+}
+
+int (*heuristic_by_name(const char *name))(unsigned long state, int nmoves)
+{ /* returns heuristic of given name, NULL if none */
+  int i;
+  for (i = 0; heuristics[i].name; i++) {
+    if (strcmp(heuristics[i].name, name) == 0) return heuristics[i].function;
+  }
+  return NULL;
+}
+
+void children_h_scores(int (*heuristic)(unsigned long state, int nmoves), unsigned long state,
+		       int h_score, const unsigned long child[], int nchildren, int h[])
+{ /* heuristic values of all children of state, whose heuristic value is h_score,
+     by the batched kernels where there are some */
+  int i;
+  if (heuristic == manhattan_distance_heuristic) { /* a single tile moved */
+    for (i = 0; i < nchildren; i++) h[i] = h_score + manhattan_distance_delta(state, child[i]);
+  } else if (heuristic == misplaced_tile_heuristic) {
+    misplaced_children_kernel(child, nchildren, h);
+  } else if (heuristic == linear_conflict_heuristic) {
+    manhattan_children_kernel(child, nchildren, h);
+    for (i = 0; i < nchildren; i++) h[i] += linear_conflicts(child[i]);
+  } else {
+    for (i = 0; i < nchildren; i++) h[i] = heuristic(child[i], 0);
+  }
+}
+
+
+puzzle *a_star_step(priorityQ *priorityQp, closed_set *closed, node_pool *pool, int (*heuristic)(unsigned long int state, int nmoves),
+		   solution_cache *cachep, cache_hits *hits, cache_entry *hit)
+{ /* performs one step of a_star, allocating boards of children from pool;
+     with a solution cache, returns a cached board with its entry in hit,
+     keeping the entries of requeued boards in hits */
+  int i;
+  unsigned long child[4];
+  int nchildren;
+  puzzle *candidate;
+  puzzle *next_boardp;
+  closed_node *node; /* closed set entry of extracted state */
+  while (true) {
+    STAT_TIME(ns_queue, next_boardp = priorityQ_extract_min(priorityQp));
+    if (next_boardp == NULL) {
+      log_info("error, failed to extract from priority queue");
+      return NULL;
+    }
+    STAT_TIME(ns_closed, node = closed_find(closed, next_boardp->state));
+    if (node->processed) {
+      STAT(stats.stale++); /* superseded by a board of lower f_score, already expanded */
+      pool_release(pool, next_boardp);
+      continue;
+    }
+    if (cachep == NULL || next_boardp->state == END_STATE) break;
+    /* a cached state extracted at its exact f_score completes an optimal
+       solution; otherwise it is requeued at its exact f_score, with the
+       entry it hit (a lookup on extraction could miss, and expanding it
+       there, past its f_score, would lose optimality) */
+    if (next_boardp->cached) {
+      *hit = hits->entries[next_boardp->hit];
+      return next_boardp;
+    }
+    if (!cache_lookup(cachep, next_boardp->state, hit)) break;
+    if (hit->distance == next_boardp->h_score) {
+      next_boardp->cached = true;
+      return next_boardp;
+    }
+    if (next_boardp->nmoves + hit->distance < MAX_MOVES) {
+      bool inserted;
+      int index = cache_hits_add(hits, hit);
+      if (index < 0) break; /* expanded at its f_score instead */
+      candidate = board_init(pool, next_boardp->state, next_boardp->nmoves);
+      if (candidate == NULL) return NULL;
+      candidate->h_score = next_boardp->h_score;
+      candidate->cached = true;
+      candidate->hit = index;
+      STAT_TIME(ns_queue, inserted = priorityQ_insert(priorityQp, candidate, next_boardp->nmoves + hit->distance));
+      if (!inserted) return NULL;
+    }
+    pool_release(pool, next_boardp);
+  }
+
+  if (next_boardp->state == END_STATE) { /* solved */
+    return next_boardp;
+  }
+
+  int f_score;
+  int h_score[4]; /* of children */
+  int aux_f_score; /* INT_MAX if child is not (re)inserted into priority queue */
+ 
+  STAT_TIME(ns_successors, nchildren = enum_states(next_boardp->state, child));
+  STAT(stats.expanded++; stats.generated += nchildren);
+  STAT_TIME(ns_heuristic, children_h_scores(heuristic, next_boardp->state, next_boardp->h_score,
+					    child, nchildren, h_score));
+  for (i = 0; i < nchildren; i++) { /* for children of extracted state */
+    f_score = h_score[i] + next_boardp->nmoves + 1; /* calculate f_score */
+    if (f_score >= MAX_MOVES) continue; /* beyond priority queue */
+    STAT_TIME(ns_closed, aux_f_score = closed_discover(closed, child[i], next_boardp->state,
+						       next_boardp->nmoves + 1, f_score));
+    if (aux_f_score < 0) return NULL; /* closed set is full */
+    if (aux_f_score != INT_MAX) { /* board of higher f_score, if any, goes stale */
+      bool inserted;
+      candidate = board_init(pool, child[i], next_boardp->nmoves + 1); /* initialize child board */
+      if (candidate == NULL) return NULL;
+      candidate->h_score = h_score[i];
+      STAT_TIME(ns_queue, inserted = priorityQ_insert(priorityQp, candidate, f_score)); /* insert into priority queue */
+      if (!inserted) return NULL;
+    }    
+  }
+  node->processed = true; /* process state */
   return next_boardp;
 }
 
-puzzle *a_star(priorityQ *priorityQp, hash_node closed[], int (*heuristic)(unsigned long int state, int nmoves))
+puzzle *a_star(priorityQ *priorityQp, closed_set *closed, node_pool *pool, int (*heuristic)(unsigned long int state, int nmoves),
+	       solution_cache *cachep, cache_hits *hits, cache_entry *hit, const memory_bound *bound)
+{ /* returns board of END_STATE, or a cached board with its entry in hit;
+     with a memory bound, returns the last board expanded once the bound is
+     reached, leaving the frontier on the priority queue */
+  if (priorityQp->nelements == 0) { /* no elements to extract */
+    log_info("error: no elements in the priority queue");
+    return NULL;
+  }
+  puzzle *boardp = a_star_step(priorityQp, closed, pool, heuristic, cachep, hits, hit); /* extract first processed state */
+  puzzle *temp = boardp;
+  if (boardp == NULL) return NULL;
+  while (boardp->state != END_STATE && !boardp->cached)
+    {
+      if (bound && (priorityQp->nelements >= bound->max_boards || closed->discovered >= bound->max_states)) {
+	return boardp;
+      }
+      if (priorityQp->nelements == 0) { /* no elements to extract */
+	log_info("error: no elements in the priority queue");
+	return NULL;
+      }
+      boardp= a_star_step(priorityQp, closed, pool, heuristic, cachep, hits, hit);
+      pool_release(pool, temp); /* release previous board */
+      if (boardp == NULL) return NULL;
+      temp = boardp;
+    }
+  return boardp;
+}
+
+
+/********************************************
+ *       OPERATIONS FOR IDA* SEARCH         *
+ ********************************************/
+
+/**********************************************
+ *  Iterative-deepening A*: depth-first searches bounded by f_score,
+ *  raising the bound to the least f_score exceeding it after each
+ *  iteration. The state is changed in place by slide_tile and restored
+ *  on return, moves are kept on a fixed-size stack, and the move
+ *  undoing the previous one is never tried, so no memory is allocated.
+ **********************************************/
+
+typedef struct ida_search {
+  int (*heuristic)(unsigned long state, int nmoves); /* NULL for manhattan distance to goal */
+  unsigned long goal; /* END_STATE, or goal of a query that cannot be relabeled */
+  const unsigned char (*manhattan)[BOARD_CELLS]; /* manhattan distance to goal, without heuristic */
+  unsigned long state; /* current state, changed in place */
+  int bound; /* f_score bound of current iteration */
+  int next_bound; /* least f_score exceeding bound */
+  int nmoves; /* number of moves of solution */
+  long expanded; /* number of states expanded, over all iterations */
+  closed_set *closed; /* states covered by frontier of bounded astar, NULL for ida */
+  unsigned char moves[MAX_MOVES]; /* moves of the blank from initial state */
+} ida_search;
+
+bool ida_dfs(ida_search *search, int blank, int nmoves, int h_score)
+{ /* depth-first search below current state, returns true if solved */
+  int i, child_h;
+  int f_score = h_score + nmoves;
+  unsigned long state = search->state;
+  const neighbor_list *next = &neighbors[blank];
+
+  if (f_score > search->bound) {
+    if (f_score < search->next_bound) search->next_bound = f_score;
+    return false;
+  }
+  if (state == search->goal) {
+    search->nmoves = nmoves;
+    return true;
+  }
+  if (nmoves + 1 >= MAX_MOVES) return false;
+  search->expanded++;
+  STAT(stats.expanded++);
+
+  for (i = 0; i < next->count; i++) {
+    int move = next->move[i];
+    if (nmoves > 0 && move == (search->moves[nmoves - 1] ^ 1)) continue; /* undoes previous move */
+    STAT_TIME(ns_successors, search->state = slide_tile(state, blank, next->cell[i])); /* make move */
+    search->moves[nmoves] = move;
+    STAT(stats.generated++);
+    if (search->closed) { /* reached as cheaply by astar: searched from its frontier */
+      closed_node *node;
+      STAT_TIME(ns_closed, node = closed_lookup(search->closed, search->state));
+      if (node && node->discovered && node->nmoves <= nmoves + 1) {
+	search->state = state;
+	continue;
+      }
+    }
+    if (search->heuristic == NULL) { /* tile at cell moved into blank */
+      int tile = (state >> (4 * next->cell[i])) & 0xF;
+      child_h = h_score + search->manhattan[tile][blank] - search->manhattan[tile][next->cell[i]];
+    } else {
+      STAT_TIME(ns_heuristic, child_h = child_h_score(search->heuristic, state, h_score, search->state));
+    }
+    if (ida_dfs(search, next->cell[i], nmoves + 1, child_h)) return true;
+    search->state = state; /* unmake move */
+  }
+  return false;
+}
+
+int ida_iterate(ida_search *search, unsigned long state, int h_score)
+{ /* iterations of IDA* from state of heuristic value h_score towards the
+     goal of search, returns number of moves, or -1 if not solved within MAX_MOVES */
+  search->bound = h_score;
+  search->expanded = 0;
+  search->closed = NULL;
+  while (search->bound < MAX_MOVES) {
+    search->state = state;
+    search->next_bound = INT_MAX;
+    if (ida_dfs(search, blank_index(state), 0, h_score)) return search->nmoves;
+    search->bound = search->next_bound;
+  }
+  log_info("no solution within %d moves", MAX_MOVES);
+  return -1;
+}
+
+int ida_star(ida_search *search, unsigned long state, int (*heuristic)(unsigned long state, int nmoves))
+{ /* solve state by IDA*, returns number of moves, or -1 if not solved within MAX_MOVES */
+  search->heuristic = heuristic;
+  search->goal = END_STATE;
+  return ida_iterate(search, state, heuristic(state, 0));
+}
+
+/********************************************
+ *   OPERATIONS FOR MEMORY-BOUNDED SEARCH   *
+ ********************************************/
+
+/**********************************************
+ *  Memory-bounded astar (-M): the closed set is sized to the budget, and
+ *  astar stops growing its frontier once the boards on the priority
+ *  queue, or the states in the closed set, fill what the budget holds.
+ *  The search goes on depth-first from the boards left on the priority
+ *  queue, least f_score first, with the rising bounds of ida: every path
+ *  to the goal leaves the expanded states through a frontier board, so
+ *  the first solution within the least bound is optimal. Below a frontier
+ *  board, a state the closed set holds with as few moves is not searched
+ *  again (it is on the frontier, or behind it); any other state is
+ *  expanded again on each iteration, which is the price of the bound.
+ **********************************************/
+
+#define BOUNDED_BOARD_BYTES (sizeof(puzzle) + 2 * sizeof(puzzle *)) /* board of node pool, and its slot in a bucket of twice its count */
+#define BOUNDED_MIN_BITS 10 /* log2 of least slots of closed set */
+
+long memory_budget = 0; /* bytes of astar, set by -M, unbounded if 0 */
+
+long bytes_by_text(const char *text)
+{ /* number of bytes of text, with optional suffix k, m or g; -1 if invalid */
+  char *end;
+  long bytes = strtol(text, &end, 10);
+  if (end == text || bytes <= 0) return -1;
+  switch (*end) {
+  case 'g': case 'G': bytes <<= 10; /* fall through */
+  case 'm': case 'M': bytes <<= 10; /* fall through */
+  case 'k': case 'K': bytes <<= 10; end++; break;
+  }
+  return *end == '\0' ? bytes : -1;
+}
+
+bool memory_bound_init(memory_bound *bound, long budget)
+{ /* limits of astar within budget bytes, returns false if the budget
+     does not hold the fixed tables of astar and a slab of boards */
+  long fixed = sizeof(priorityQ) + sizeof(closed_set);
+  bound->budget = budget;
+#if BOARD_RANKED
+  bound->bits = 0;
+  fixed += PERMUTATIONS * sizeof(closed_node);
+  bound->max_states = LONG_MAX; /* every state has its slot */
+#else
+  bound->bits = CLOSED_BITS;
+  while (bound->bits > BOUNDED_MIN_BITS && (long)(sizeof(closed_node) << bound->bits) > budget / 2) {
+    bound->bits--;
+  }
+  fixed += sizeof(closed_node) << bound->bits;
+  bound->max_states = (1L << bound->bits) / 2; /* probes stay short at half load */
+#endif
+  bound->max_boards = (budget - fixed) / (long)BOUNDED_BOARD_BYTES;
+  check(bound->max_boards >= POOL_SLAB, "memory bound of %ld bytes is below the %ld bytes astar needs",
+	budget, fixed + POOL_SLAB * (long)BOUNDED_BOARD_BYTES);
+  return true;
+ error:
+  return false;
+}
+
+int frontier_next_f(priorityQ *priorityQp, int f)
+{ /* least f_score above f of boards on priority queue, MAX_MOVES if none */
+  int g;
+  for (f++; f < MAX_MOVES; f++) {
+    for (g = priorityQp->max_g[f]; g >= 0; g--) {
+      if (priorityQp->queue[f][g].count > 0) return f;
+    }
+  }
+  return MAX_MOVES;
+}
+
+int frontier_star(ida_search *search, priorityQ *priorityQp, closed_set *closed,
+		  int (*heuristic)(unsigned long state, int nmoves))
+{ /* solve depth-first from the boards left on the priority queue by astar,
+     returns number of moves (moves in search), or -1 if not solved within MAX_MOVES */
+  int f, g, i;
+  search->heuristic = heuristic;
+  search->goal = END_STATE;
+  search->expanded = 0;
+  search->closed = closed;
+  search->bound = frontier_next_f(priorityQp, priorityQp->min_index - 1);
+  while (search->bound < MAX_MOVES) {
+    search->next_bound = INT_MAX;
+    for (f = priorityQp->min_index; f <= search->bound; f++) {
+      for (g = priorityQp->max_g[f]; g >= 0; g--) { /* deepest first, as astar */
+	priorityQ_bucket *bucket = &priorityQp->queue[f][g];
+	for (i = bucket->count - 1; i >= 0; i--) {
+	  puzzle *boardp = bucket->boards[i];
+	  closed_node *node = closed_lookup(closed, boardp->state);
+	  if (node->processed || node->nmoves != boardp->nmoves) continue; /* stale */
+	  closed_moves(closed, boardp->state, search->moves);
+	  search->state = boardp->state;
+	  if (ida_dfs(search, blank_index(boardp->state), boardp->nmoves, boardp->h_score)) {
+	    return search->nmoves;
+	  }
+	}
+      }
+    }
+    f = frontier_next_f(priorityQp, search->bound);
+    search->bound = search->next_bound < f ? search->next_bound : f;
+  }
+  log_info("no solution within %d moves", MAX_MOVES);
+  return -1;
+}
+
+/********************************************
+ *       OPERATIONS FOR HDA* SEARCH         *
+ ********************************************/
+
+/**********************************************
+ *  Hash-distributed A*: every state is owned by one thread, given by a
+ *  hash of the state. A thread expands boards from its own priority
+ *  queue, and sends each child to the inbox of its owner, a lock-free
+ *  stack that the owner empties at once. Only the owner of a state
+ *  writes its closed set entry, so threads share the closed set.
+ *
+ *  Threads expand out of global f_score order, so a state may be reached
+ *  again with fewer moves after it was processed; it is then reopened,
+ *  and boards superseded by a better path are skipped when extracted.
+ *  The best solution found prunes all boards that cannot improve on it,
+ *  and the search ends once every thread is idle and no board is in
+ *  flight: counters of boards sent and received are read before and
+ *  after the idle flags, and must all agree.
+ *
+ *  The threads are started once with the solver context, and wait between
+ *  solves: hda_star seeds a query, wakes them, and waits until all of them
+ *  have left it.
+ **********************************************/
+
+typedef struct hda_worker {
+  pthread_t thread;
+  int id;
+  priorityQ *priorityQp; /* boards owned by worker */
+  node_pool *pool; /* boards allocated by worker; boards it drops or has expanded
+		      are released to it, whichever pool they came from */
+  _Atomic(puzzle *) inbox; /* boards sent to worker */
+  atomic_bool idle; /* no board to expand below best, and inbox was empty */
+  long expanded; /* number of states expanded, over all solves */
+  struct hda_search *search;
+} hda_worker;
+
+typedef struct hda_search {
+  int nworkers;
+  hda_worker *workers;
+  closed_set *closed; /* shared, written by owner of state only */
+  int (*heuristic)(unsigned long state, int nmoves);
+  atomic_int best; /* number of moves of best solution found */
+  atomic_long sent; /* boards sent to other workers */
+  atomic_long received; /* boards received from other workers */
+  atomic_bool full; /* closed set is full, search is abandoned */
+  atomic_bool done;
+  int nstarted; /* threads running */
+  pthread_mutex_t lock; /* guards query, running and quit */
+  pthread_cond_t wake; /* new query, or quit */
+  pthread_cond_t finished; /* no thread running the query */
+  long query; /* number of queries started */
+  int running; /* threads still in current query */
+  bool quit; /* threads exit */
+} hda_search;
+
+int hda_owner(unsigned long state, int nworkers)
+{ /* worker owning state */
+  return ((state * 0x9E3779B97F4A7C15UL) >> 32) % nworkers;
+}
+
+void hda_receive(hda_worker *worker, puzzle *boardp)
+{ /* discover board at its owner; reopens processed states reached with fewer moves */
+  closed_node *node = closed_find(worker->search->closed, boardp->state);
+  int f_score = boardp->nmoves + boardp->h_score;
+  if (node == NULL) {
+    log_err("closed set is full");
+    pool_release(worker->pool, boardp);
+    atomic_store(&worker->search->full, true);
+    atomic_store(&worker->search->done, true);
+    return;
+  }
+  if ((node->discovered && boardp->nmoves >= node->nmoves) ||
+      f_score >= atomic_load(&worker->search->best)) {
+    pool_release(worker->pool, boardp); /* no better than known */
+    return;
+  }
+  node->discovered = true;
+  node->processed = false;
+  node->nmoves = boardp->nmoves;
+  node->f_score = f_score;
+  node->parent_move = boardp->move;
+  if (!priorityQ_insert(worker->priorityQp, boardp, f_score)) {
+    atomic_store(&worker->search->full, true);
+    atomic_store(&worker->search->done, true);
+  }
+}
+
+void hda_send(hda_worker *worker, puzzle *boardp)
+{ /* send board to its owner */
+  hda_search *search = worker->search;
+  hda_worker *owner = &search->workers[hda_owner(boardp->state, search->nworkers)];
+  if (owner == worker) {
+    hda_receive(worker, boardp);
+    return;
+  }
+  atomic_fetch_add(&search->sent, 1); /* in flight before it can be received */
+  boardp->next = atomic_load(&owner->inbox);
+  while (!atomic_compare_exchange_weak(&owner->inbox, &boardp->next, boardp));
+}
+
+bool hda_drain(hda_worker *worker)
+{ /* receive all boards of inbox, returns true if any */
+  puzzle *boardp = atomic_exchange(&worker->inbox, NULL);
+  long count = 0;
+  if (boardp == NULL) return false;
+  atomic_store(&worker->idle, false);
+  while (boardp) {
+    puzzle *next = boardp->next;
+    hda_receive(worker, boardp);
+    boardp = next;
+    count++;
+  }
+  atomic_fetch_add(&worker->search->received, count);
+  return true;
+}
+
+void hda_expand(hda_worker *worker, puzzle *boardp)
+{ /* expand board, sending its children to their owners */
+  hda_search *search = worker->search;
+  closed_node *node = closed_find(search->closed, boardp->state);
+  unsigned long child[4];
+  int nchildren, i;
+  if (node->processed || boardp->nmoves > node->nmoves) return; /* superseded */
+  node->processed = true;
+  if (boardp->state == END_STATE) {
+    int best = atomic_load(&search->best);
+    while (boardp->nmoves < best &&
+	   !atomic_compare_exchange_weak(&search->best, &best, boardp->nmoves));
+    return;
+  }
+  worker->expanded++;
+  nchildren = enum_states(boardp->state, child);
+  for (i = 0; i < nchildren; i++) {
+    int h_score = child_h_score(search->heuristic, boardp->state, boardp->h_score, child[i]);
+    puzzle *candidate;
+    if (boardp->nmoves + 1 + h_score >= atomic_load(&search->best)) continue; /* cannot improve */
+    candidate = board_init(worker->pool, child[i], boardp->nmoves + 1);
+    if (candidate == NULL) continue;
+    candidate->h_score = h_score;
+    candidate->move = move_direction(boardp->state, child[i]);
+    hda_send(worker, candidate);
+  }
+}
+
+bool hda_terminated(hda_search *search)
+{ /* all workers idle, and no board in flight */
+  long sent = atomic_load(&search->sent);
+  long received = atomic_load(&search->received);
+  int i;
+  if (sent != received) return false;
+  for (i = 0; i < search->nworkers; i++) {
+    if (!atomic_load(&search->workers[i].idle)) return false;
+  }
+  return atomic_load(&search->sent) == sent && atomic_load(&search->received) == received;
+}
+
+void hda_work(hda_worker *worker)
+{ /* expand own boards and receive others', until the query is done */
+  hda_search *search = worker->search;
+  while (!atomic_load(&search->done)) {
+    priorityQ *priorityQp = worker->priorityQp;
+    hda_drain(worker);
+    if (priorityQp->nelements > 0) {
+      puzzle *boardp = priorityQ_extract_min(priorityQp);
+      if (boardp->nmoves + boardp->h_score < atomic_load(&search->best)) {
+	hda_expand(worker, boardp);
+	pool_release(worker->pool, boardp);
+	continue;
+      }
+      /* boards left cannot improve on best */
+      pool_release(worker->pool, boardp);
+      priorityQ_reset(priorityQp);
+    }
+    if (atomic_load(&worker->inbox) != NULL) continue;
+    atomic_store(&worker->idle, true);
+    if (atomic_load(&worker->inbox) != NULL) continue;
+    if (hda_terminated(search)) atomic_store(&search->done, true);
+    sched_yield();
+  }
+}
+
+void *hda_run(void *arg)
+{ /* worker thread: work on each query, until told to quit */
+  hda_worker *worker = arg;
+  hda_search *search = worker->search;
+  long query = 0; /* last query worked on */
+  pthread_mutex_lock(&search->lock);
+  while (true) {
+    while (search->query == query && !search->quit) pthread_cond_wait(&search->wake, &search->lock);
+    if (search->quit) break;
+    query = search->query;
+    pthread_mutex_unlock(&search->lock);
+    hda_work(worker);
+    pthread_mutex_lock(&search->lock);
+    if (--search->running == 0) pthread_cond_signal(&search->finished);
+  }
+  pthread_mutex_unlock(&search->lock);
+  return NULL;
+}
+
+void hda_stop(hda_search *search)
+{ /* tell threads to quit, and wait for them */
+  int i;
+  pthread_mutex_lock(&search->lock);
+  search->quit = true;
+  pthread_cond_broadcast(&search->wake);
+  pthread_mutex_unlock(&search->lock);
+  for (i = 0; i < search->nstarted; i++) {
+    pthread_join(search->workers[i].thread, NULL);
+  }
+  search->nstarted = 0;
+}
+
+hda_search *hda_init(int nworkers)
+{ /* initialize queues and node pools of nworkers workers, and start their
+     threads waiting for a query; all are kept over solves */
+  int i;
+  hda_search *search = calloc(1, sizeof(*search));
+  check_mem(search);
+  search->nworkers = nworkers;
+  pthread_mutex_init(&search->lock, NULL);
+  pthread_cond_init(&search->wake, NULL);
+  pthread_cond_init(&search->finished, NULL);
+  search->workers = calloc(nworkers, sizeof(hda_worker));
+  check_mem(search->workers);
+  for (i = 0; i < nworkers; i++) {
+    hda_worker *worker = &search->workers[i];
+    worker->id = i;
+    worker->search = search;
+    worker->priorityQp = priorityQ_init();
+    worker->pool = pool_init();
+    check_mem(worker->priorityQp);
+    check_mem(worker->pool);
+  }
+  for (i = 0; i < nworkers; i++) {
+    check(pthread_create(&search->workers[i].thread, NULL, hda_run, &search->workers[i]) == 0,
+	  "failed to start worker %d", i);
+    search->nstarted++;
+  }
+  return search;
+ error:
+  log_info("error allocating memory for hda");
+  if (search) {
+    hda_stop(search);
+    if (search->workers) {
+      for (i = 0; i < nworkers; i++) {
+	free(search->workers[i].priorityQp);
+	free(search->workers[i].pool);
+      }
+    }
+    free(search->workers);
+    pthread_mutex_destroy(&search->lock);
+    pthread_cond_destroy(&search->wake);
+    pthread_cond_destroy(&search->finished);
+    free(search);
+  }
+  return NULL;
+}
+
+int hda_star(hda_search *search, unsigned long state, closed_set *closed,
+	     int (*heuristic)(unsigned long state, int nmoves))
+{ /* solve state by HDA* on the workers of search sharing closed set,
+     returns number of moves, or -1 if not solved */
+  puzzle *boardp;
+  int i;
+  search->closed = closed;
+  search->heuristic = heuristic;
+  atomic_store(&search->best, MAX_MOVES);
+  atomic_store(&search->sent, 0);
+  atomic_store(&search->received, 0);
+  atomic_store(&search->full, false);
+  atomic_store(&search->done, false);
+  for (i = 0; i < search->nworkers; i++) {
+    atomic_store(&search->workers[i].inbox, NULL);
+    atomic_store(&search->workers[i].idle, false);
+  }
+
+  boardp = board_init(search->workers[0].pool, state, 0);
+  check_mem(boardp);
+  boardp->h_score = heuristic(state, 0);
+  boardp->move = 0;
+  hda_send(&search->workers[0], boardp);
+
+  pthread_mutex_lock(&search->lock); /* publishes the query to the threads */
+  search->running = search->nworkers;
+  search->query++;
+  pthread_cond_broadcast(&search->wake);
+  while (search->running > 0) pthread_cond_wait(&search->finished, &search->lock);
+  pthread_mutex_unlock(&search->lock);
+  if (atomic_load(&search->full)) return -1;
+  return atomic_load(&search->best) < MAX_MOVES ? atomic_load(&search->best) : -1;
+ error:
+  return -1;
+}
+
+void hda_reset(hda_search *search)
+{ /* clear queues and node pools of all workers for next instance; boards
+     released across pools are reclaimed with the slabs of their own pool */
+  int i;
+  for (i = 0; i < search->nworkers; i++) {
+    priorityQ_reset(search->workers[i].priorityQp);
+    pool_reset(search->workers[i].pool);
+  }
+}
+
+void hda_free(hda_search *search)
+{ /* stop threads, and free queues and node pools of all workers */
+  int i;
+  hda_stop(search);
+  for (i = 0; i < search->nworkers; i++) {
+    priorityQ_free(search->workers[i].priorityQp);
+    pool_free(search->workers[i].pool);
+  }
+  free(search->workers);
+  pthread_mutex_destroy(&search->lock);
+  pthread_cond_destroy(&search->wake);
+  pthread_cond_destroy(&search->finished);
+  free(search);
+}
+
+/********************************************
+ *   OPERATIONS FOR BIDIRECTIONAL SEARCH    *
+ ********************************************/
+
+/**********************************************
+ *  MM (Holte et al.): A* forward from the initial state to END_STATE and
+ *  backward from END_STATE to the initial state, each side with its own
+ *  priority queue, closed set and node pool, expanding boards in order
+ *  of priority max(f_score, 2 * nmoves), so that neither side goes past
+ *  the middle of an optimal solution. A child that the other side has
+ *  discovered closes a solution of the moves of both sides, and the best
+ *  one is optimal once it is no longer than the least priority, the least
+ *  f_score of either side, or the least moves of both sides + 1.
+ *
+ *  The forward side uses the heuristic of the solver, the backward side
+ *  manhattan distance to the initial state (none with no heuristic).
+ *  A state reached again with fewer moves is reopened; its old board
+ *  stays on the queue and is skipped when it comes to the top.
+ **********************************************/
+
+typedef struct bidir_side {
+  priorityQ *priorityQp; /* open boards, by priority */
+  closed_set *closed; /* nmoves and parent move of states, f_score of open states */
+  node_pool *pool;
+  int (*heuristic)(unsigned long state, int nmoves); /* NULL for table */
+  unsigned char manhattan[16][BOARD_CELLS]; /* manhattan distance to initial state (backward) */
+  int gcount[MAX_MOVES]; /* open states by nmoves */
+  int fcount[MAX_MOVES]; /* open states by f_score */
+  int gmin, fmin; /* lower bounds of nmoves and f_score of open states */
+} bidir_side;
+
+typedef struct bidir_search {
+  bidir_side sides[2]; /* forward, backward */
+  int best; /* number of moves of best solution found, MAX_MOVES if none */
+  unsigned long meet; /* state where the sides of best solution meet */
+  bool full; /* a closed set is full */
+  long expanded; /* number of states expanded, both sides */
+} bidir_search;
+
+bidir_search *bidir_init(void)
+{ /* initialize queues, closed sets and node pools of both sides */
+  int i;
+  bidir_search *search = calloc(1, sizeof(*search));
+  check_mem(search);
+  for (i = 0; i < 2; i++) {
+    search->sides[i].priorityQp = priorityQ_init();
+    search->sides[i].closed = closed_init();
+    search->sides[i].pool = pool_init();
+    check_mem(search->sides[i].priorityQp);
+    check_mem(search->sides[i].closed);
+    check_mem(search->sides[i].pool);
+  }
+  return search;
+ error:
+  log_info("error allocating memory for bidirectional search");
+  if (search) {
+    for (i = 0; i < 2; i++) {
+      free(search->sides[i].priorityQp);
+      if (search->sides[i].closed) closed_free(search->sides[i].closed);
+      free(search->sides[i].pool);
+    }
+    free(search);
+  }
+  return NULL;
+}
+
+int bidir_h_score(bidir_side *side, unsigned long state, int h_score, unsigned long child)
+{ /* heuristic value of child of state to target of side, state has h_score */
+  if (side->heuristic) return child_h_score(side->heuristic, state, h_score, child);
+  return h_score + manhattan_table_delta(side->manhattan, state, child);
+}
+
+void bidir_count(bidir_side *side, int nmoves, int f_score, int delta)
+{ /* add delta open states of nmoves and f_score */
+  side->gcount[nmoves] += delta;
+  side->fcount[f_score] += delta;
+  if (delta > 0) {
+    if (nmoves < side->gmin) side->gmin = nmoves;
+    if (f_score < side->fmin) side->fmin = f_score;
+    return;
+  }
+  while (side->gmin < MAX_MOVES - 1 && side->gcount[side->gmin] == 0) side->gmin++;
+  while (side->fmin < MAX_MOVES - 1 && side->fcount[side->fmin] == 0) side->fmin++;
+}
+
+bool bidir_open(bidir_search *search, int s, unsigned long state, int nmoves, int h_score, int move)
+{ /* discover state on side s, or reopen it with fewer moves, and check whether
+     the other side closes a better solution; returns false if closed set is full */
+  bidir_side *side = &search->sides[s];
+  closed_node *node, *other;
+  puzzle *boardp;
+  bool inserted;
+  int f_score = nmoves + h_score;
+  int priority = f_score > 2 * nmoves ? f_score : 2 * nmoves;
+  if (f_score >= search->best || priority >= MAX_MOVES) return true; /* cannot improve */
+
+  STAT_TIME(ns_closed, node = closed_find(side->closed, state));
+  if (node == NULL) {
+    log_err("closed set is full");
+    search->full = true;
+    return false;
+  }
+  if (node->discovered) {
+    if (node->nmoves <= nmoves) { /* no better than known */
+      STAT(stats.duplicates++);
+      return true;
+    }
+    STAT(stats.improved++; stats.reopened += node->processed);
+    if (!node->processed) bidir_count(side, node->nmoves, node->f_score, -1); /* old board goes stale */
+  }
+  node->discovered = true;
+  node->processed = false;
+  node->nmoves = nmoves;
+  node->f_score = f_score;
+  node->parent_move = move;
+  bidir_count(side, nmoves, f_score, 1);
+
+  boardp = board_init(side->pool, state, nmoves);
+  if (boardp == NULL) {
+    search->full = true;
+    return false;
+  }
+  boardp->h_score = h_score;
+  STAT_TIME(ns_queue, inserted = priorityQ_insert(side->priorityQp, boardp, priority));
+  if (!inserted) {
+    search->full = true;
+    return false;
+  }
+
+  STAT_TIME(ns_closed, other = closed_lookup(search->sides[!s].closed, state));
+  if (other && other->discovered && nmoves + other->nmoves < search->best) {
+    search->best = nmoves + other->nmoves;
+    search->meet = state;
+  }
+  return true;
+}
+
+puzzle *bidir_top(bidir_side *side)
+{ /* board of least priority still open on side, left on queue; NULL if none */
+  puzzle *boardp;
+  while (true) {
+    closed_node *node;
+    STAT_TIME(ns_queue, boardp = priorityQ_min(side->priorityQp));
+    if (boardp == NULL) break;
+    STAT_TIME(ns_closed, node = closed_find(side->closed, boardp->state));
+    if (!node->processed && node->nmoves == boardp->nmoves) return boardp;
+    STAT_TIME(ns_queue, boardp = priorityQ_extract_min(side->priorityQp));
+    pool_release(side->pool, boardp); /* superseded */
+    STAT(stats.stale++);
+  }
+  return NULL;
+}
+
+bool bidir_expand(bidir_search *search, int s)
+{ /* expand board of least priority on side s; returns false if closed set is full */
+  bidir_side *side = &search->sides[s];
+  puzzle *boardp;
+  closed_node *node;
+  unsigned long child[4];
+  int nchildren, i;
+  STAT_TIME(ns_queue, boardp = priorityQ_extract_min(side->priorityQp));
+  STAT_TIME(ns_closed, node = closed_find(side->closed, boardp->state));
+  node->processed = true;
+  bidir_count(side, node->nmoves, node->f_score, -1);
+  search->expanded++;
+
+  STAT_TIME(ns_successors, nchildren = enum_states(boardp->state, child));
+  STAT(stats.expanded++; stats.generated += nchildren);
+  for (i = 0; i < nchildren; i++) {
+    int h_score;
+    STAT_TIME(ns_heuristic, h_score = bidir_h_score(side, boardp->state, boardp->h_score, child[i]));
+    if (!bidir_open(search, s, child[i], boardp->nmoves + 1, h_score,
+		    move_direction(boardp->state, child[i]))) return false;
+  }
+  pool_release(side->pool, boardp);
+  return true;
+}
+
+int bidir_star(bidir_search *search, unsigned long state,
+	       int (*heuristic)(unsigned long state, int nmoves), unsigned char moves[])
+{ /* solve state by MM into moves, returns number of moves, or -1 if not solved */
+  bidir_side *forward = &search->sides[0];
+  bidir_side *backward = &search->sides[1];
+  unsigned char back[MAX_MOVES];
+  int i, nforward, nbackward;
+  search->best = MAX_MOVES;
+  search->full = false;
+  search->expanded = 0;
+  forward->heuristic = heuristic;
+  backward->heuristic = NULL;
+  if (heuristic == no_heuristic) {
+    memset(backward->manhattan, 0, sizeof(backward->manhattan));
+  } else {
+    manhattan_table_init(backward->manhattan, state);
+  }
+  for (i = 0; i < 2; i++) {
+    search->sides[i].gmin = search->sides[i].fmin = MAX_MOVES - 1;
+  }
+
+  if (!bidir_open(search, 0, state, 0, heuristic(state, 0), 0) ||
+      !bidir_open(search, 1, END_STATE, 0, manhattan_table_distance(backward->manhattan, END_STATE), 0)) {
+    return -1;
+  }
+  while (true) {
+    puzzle *top[2] = { bidir_top(forward), bidir_top(backward) };
+    int priority[2], bound;
+    if (top[0] == NULL || top[1] == NULL) break; /* every better solution is ruled out */
+    priority[0] = forward->priorityQp->min_index;
+    priority[1] = backward->priorityQp->min_index;
+    bound = priority[0] < priority[1] ? priority[0] : priority[1];
+    if (forward->fmin > bound) bound = forward->fmin;
+    if (backward->fmin > bound) bound = backward->fmin;
+    if (forward->gmin + backward->gmin + 1 > bound) bound = forward->gmin + backward->gmin + 1;
+    if (search->best <= bound) break; /* optimal */
+    if (!bidir_expand(search, priority[0] <= priority[1] ? 0 : 1)) return -1;
+  }
+  if (search->full || search->best == MAX_MOVES) return -1;
+
+  nforward = closed_moves(forward->closed, search->meet, moves);
+  nbackward = closed_moves(backward->closed, search->meet, back);
+  for (i = 0; i < nbackward; i++) { /* moves from meet to END_STATE undo those of backward side */
+    moves[nforward + i] = back[nbackward - 1 - i] ^ 1;
+  }
+  return nforward + nbackward;
+}
+
+long bidir_reset(bidir_search *search)
+{ /* clear both sides for next instance, and
+     return count of states that have been discovered */
+  long count = 0;
+  int i;
+  for (i = 0; i < 2; i++) {
+    bidir_side *side = &search->sides[i];
+    priorityQ_reset(side->priorityQp);
+    pool_reset(side->pool);
+    count += closed_reset(side->closed);
+    memset(side->gcount, 0, sizeof(side->gcount));
+    memset(side->fcount, 0, sizeof(side->fcount));
+  }
+  return count;
+}
+
+void bidir_free(bidir_search *search)
+{ /* free both sides */
+  int i;
+  for (i = 0; i < 2; i++) {
+    priorityQ_free(search->sides[i].priorityQp);
+    closed_free(search->sides[i].closed);
+    pool_free(search->sides[i].pool);
+  }
+  free(search);
+}
+
+/********************************************
+ *  OPERATIONS FOR WEIGHTED/ANYTIME SEARCH  *
+ ********************************************/
+
+/**********************************************
+ *  Weighted astar orders boards by g + w * h (the key, rounded down to
+ *  index the priority queue). Once the goal's number of moves is no more
+ *  than the least key, every optimal path has a board on the queue with
+ *  key at most w times the optimum, so the solution is within w of
+ *  optimal. Anytime search (ARA*) then lowers w and goes on with the
+ *  same closed set: states expanded in the iteration are reopened, boards
+ *  of states improved after their expansion (INCONS) rejoin the queue,
+ *  and the whole queue is rekeyed. Each iteration can only shorten the
+ *  solution, and proves the bound of the best one: its moves over the
+ *  least g + h of the boards left, which bounds the optimum from below.
+ *  A query stops at the goal's own bound of 1, or when its budget of
+ *  wall time or expansions runs out, with the best solution so far.
+ **********************************************/
+
+double wall_time(void);
+
+#define ANYTIME_MAX_WEIGHT 3.0 /* keys g + w * h stay below QUEUE_KEYS */
+#define ANYTIME_MIN_STEP 0.05 /* weights closer to 1 go straight to 1 */
+
+typedef struct search_budget {
+  double weight; /* weight of h_score, 1 to ANYTIME_MAX_WEIGHT */
+  double seconds; /* wall time of query, unbounded if 0 */
+  long expansions; /* expansions of query, unbounded if 0 */
+} search_budget;
+
+search_budget query_budget = { .weight = 2.0 }; /* of wastar and ara, set by -w, -T, -X */
+
+typedef struct anytime_search {
+  priorityQ *priorityQp;
+  closed_set *closed;
+  node_pool *pool;
+  double weight; /* of h_score in keys of current iteration */
+  long expansions; /* over all iterations of solve */
+  puzzle **boards; /* boards of states improved after their expansion in this
+		      iteration (INCONS), then all boards to rekey */
+  long nboards, boards_capacity;
+  unsigned long *expanded; /* states expanded in this iteration, to reopen */
+  long nexpanded, expanded_capacity;
+} anytime_search;
+
+anytime_search *anytime_init(void)
+{ /* initialize queue, closed set and node pool */
+  anytime_search *search = calloc(1, sizeof(*search));
+  check_mem(search);
+  search->priorityQp = priorityQ_init();
+  search->closed = closed_init();
+  search->pool = pool_init();
+  check_mem(search->priorityQp);
+  check_mem(search->closed);
+  check_mem(search->pool);
+  return search;
+ error:
+  log_info("error allocating memory for anytime search");
+  if (search) {
+    free(search->priorityQp);
+    if (search->closed) closed_free(search->closed);
+    free(search->pool);
+    free(search);
+  }
+  return NULL;
+}
+
+bool anytime_push_board(anytime_search *search, puzzle *boardp)
+{ /* append board to boards of search, returns false if it fails to grow */
+  if (search->nboards == search->boards_capacity) {
+    long capacity = search->boards_capacity ? 2 * search->boards_capacity : 1024;
+    puzzle **boards = realloc(search->boards, capacity * sizeof(puzzle *));
+    check_mem(boards);
+    search->boards = boards;
+    search->boards_capacity = capacity;
+  }
+  search->boards[search->nboards++] = boardp;
+  return true;
+ error:
+  return false;
+}
+
+bool anytime_push_expanded(anytime_search *search, unsigned long state)
+{ /* append state to expanded states of iteration, returns false if it fails to grow */
+  if (search->nexpanded == search->expanded_capacity) {
+    long capacity = search->expanded_capacity ? 2 * search->expanded_capacity : 1024;
+    unsigned long *expanded = realloc(search->expanded, capacity * sizeof(unsigned long));
+    check_mem(expanded);
+    search->expanded = expanded;
+    search->expanded_capacity = capacity;
+  }
+  search->expanded[search->nexpanded++] = state;
+  return true;
+ error:
+  return false;
+}
+
+int anytime_key(const anytime_search *search, int nmoves, int h_score)
+{ /* priority of board in current iteration */
+  return nmoves + (int)(search->weight * h_score);
+}
+
+int anytime_improve(anytime_search *search, int (*heuristic)(unsigned long state, int nmoves),
+		    double deadline, long max_expansions)
+{ /* one iteration of weighted astar, returns 1 once the goal is within the
+     bound of the weight (or the queue is empty), 0 if the budget ran out,
+     -1 on error */
+  unsigned long child[4];
+  int h_score[4];
+  int i, nchildren;
+  while (search->priorityQp->nelements > 0) {
+    puzzle *boardp = priorityQ_min(search->priorityQp);
+    closed_node *node = closed_lookup(search->closed, END_STATE);
+    int best = node && node->discovered ? node->nmoves : MAX_MOVES; /* moves of goal, bound of children */
+    if (best < MAX_MOVES && best <= search->priorityQp->min_index) return 1; /* no key below goal */
+    if (max_expansions > 0 && search->expansions >= max_expansions) return 0;
+    if (deadline > 0 && search->expansions % 256 == 0 && wall_time() >= deadline) return 0;
+
+    STAT_TIME(ns_queue, boardp = priorityQ_extract_min(search->priorityQp));
+    STAT_TIME(ns_closed, node = closed_find(search->closed, boardp->state));
+    if (node->processed || node->nmoves != boardp->nmoves) { /* superseded */
+      STAT(stats.stale++);
+      pool_release(search->pool, boardp);
+      continue;
+    }
+    node->processed = true;
+    if (!anytime_push_expanded(search, boardp->state)) return -1;
+    search->expansions++;
+
+    STAT_TIME(ns_successors, nchildren = enum_states(boardp->state, child));
+    STAT(stats.expanded++; stats.generated += nchildren);
+    STAT_TIME(ns_heuristic, children_h_scores(heuristic, boardp->state, boardp->h_score,
+					      child, nchildren, h_score));
+    for (i = 0; i < nchildren; i++) {
+      int nmoves = boardp->nmoves + 1;
+      closed_node *other;
+      puzzle *candidate;
+      if (nmoves + h_score[i] >= best) continue; /* cannot improve on goal */
+      STAT_TIME(ns_closed, other = closed_find(search->closed, child[i]));
+      if (other == NULL) {
+	log_err("closed set is full");
+	return -1;
+      }
+      if (other->discovered && other->nmoves <= nmoves) {
+	STAT(stats.duplicates++);
+	continue;
+      }
+      STAT(if (other->discovered) { stats.improved++; stats.reopened += other->processed; });
+      other->discovered = true;
+      other->nmoves = nmoves;
+      other->f_score = nmoves + h_score[i];
+      other->parent_move = move_direction(boardp->state, child[i]);
+      candidate = board_init(search->pool, child[i], nmoves);
+      if (candidate == NULL) return -1;
+      candidate->h_score = h_score[i];
+      if (other->processed) { /* expanded in this iteration: wait for the next */
+	if (!anytime_push_board(search, candidate)) return -1;
+      } else if (!priorityQ_insert(search->priorityQp, candidate,
+				   anytime_key(search, nmoves, h_score[i]))) {
+	return -1;
+      }
+    }
+    pool_release(search->pool, boardp);
+  }
+  return 1;
+}
+
+bool anytime_rekey(anytime_search *search)
+{ /* start next iteration: reopen expanded states, and queue boards of
+     INCONS and of the queue with keys of current weight */
+  priorityQ *priorityQp = search->priorityQp;
+  long i;
+  int f, g, j;
+  for (i = 0; i < search->nexpanded; i++) {
+    closed_find(search->closed, search->expanded[i])->processed = false;
+  }
+  search->nexpanded = 0;
+  for (f = 0; f < QUEUE_KEYS; f++) {
+    for (g = 0; g <= priorityQp->max_g[f]; g++) {
+      priorityQ_bucket *bucket = &priorityQp->queue[f][g];
+      for (j = 0; j < bucket->count; j++) {
+	if (!anytime_push_board(search, bucket->boards[j])) return false;
+      }
+    }
+  }
+  priorityQ_reset(priorityQp);
+  for (i = 0; i < search->nboards; i++) {
+    puzzle *boardp = search->boards[i];
+    if (closed_lookup(search->closed, boardp->state)->nmoves != boardp->nmoves) { /* superseded */
+      pool_release(search->pool, boardp);
+    } else if (!priorityQ_insert(priorityQp, boardp, anytime_key(search, boardp->nmoves, boardp->h_score))) {
+      return false;
+    }
+  }
+  search->nboards = 0;
+  return true;
+}
+
+int anytime_lower_bound(anytime_search *search, int best)
+{ /* least number of moves of any solution shorter than best: least g + h
+     of the boards of the queue and INCONS, as any such solution passes one */
+  priorityQ *priorityQp = search->priorityQp;
+  int lower = best;
+  long i;
+  int f, g, j;
+  for (i = 0; i < search->nboards; i++) {
+    puzzle *boardp = search->boards[i];
+    if (boardp->nmoves + boardp->h_score < lower &&
+	closed_lookup(search->closed, boardp->state)->nmoves == boardp->nmoves) {
+      lower = boardp->nmoves + boardp->h_score;
+    }
+  }
+  for (f = 0; f < QUEUE_KEYS; f++) {
+    for (g = 0; g <= priorityQp->max_g[f]; g++) {
+      priorityQ_bucket *bucket = &priorityQp->queue[f][g];
+      for (j = 0; j < bucket->count; j++) {
+	puzzle *boardp = bucket->boards[j];
+	if (boardp->nmoves + boardp->h_score < lower &&
+	    closed_lookup(search->closed, boardp->state)->nmoves == boardp->nmoves) {
+	  lower = boardp->nmoves + boardp->h_score;
+	}
+      }
+    }
+  }
+  return lower;
+}
+
+int anytime_moves(anytime_search *search, unsigned long state, unsigned char moves[])
+{ /* moves of the blank from state to END_STATE along parents, returns
+     number of moves. a state improved after its children were generated
+     shortens the path, so parents are followed back to state rather than
+     for the moves recorded at END_STATE */
+  unsigned char reversed[MAX_MOVES];
+  unsigned long current = END_STATE;
+  int i, nmoves = 0;
+  while (current != state) {
+    closed_node *node = closed_lookup(search->closed, current);
+    reversed[nmoves++] = node->parent_move;
+    current = move_blank(current, node->parent_move ^ 1);
+  }
+  for (i = 0; i < nmoves; i++) {
+    moves[i] = reversed[nmoves - 1 - i];
+  }
+  return nmoves;
+}
+
+int anytime_star(anytime_search *search, unsigned long state, int (*heuristic)(unsigned long state, int nmoves),
+		 const search_budget *budget, bool anytime, unsigned char moves[], double *bound)
+{ /* solve state by weighted astar, lowering the weight to 1 if anytime,
+     within budget; returns number of moves of best solution (moves in
+     moves, proven bound over optimal in bound), or -1 if none was found */
+  double deadline = budget->seconds > 0 ? wall_time() + budget->seconds : 0;
+  int best = -1;
+  int result;
+  closed_node *node = closed_find(search->closed, state);
+  puzzle *boardp = board_init(search->pool, state, 0);
+  check_mem(node);
+  check_mem(boardp);
+  boardp->h_score = heuristic(state, 0);
+  node->discovered = true;
+  node->nmoves = 0;
+  node->f_score = boardp->h_score;
+  search->weight = budget->weight;
+  search->expansions = 0;
+  check(priorityQ_insert(search->priorityQp, boardp, anytime_key(search, 0, boardp->h_score)),
+	"failed to insert %lx", state);
+
+  while (true) {
+    result = anytime_improve(search, heuristic, deadline, budget->expansions);
+    node = closed_lookup(search->closed, END_STATE);
+    if (node && node->discovered && (best < 0 || node->nmoves < best)) {
+      best = anytime_moves(search, state, moves);
+    }
+    if (best >= 0) { /* bound of best by the boards left, and by the weight */
+      int lower = anytime_lower_bound(search, best);
+      *bound = lower > 0 ? (double)best / lower : 1;
+      if (result == 1 && search->weight < *bound) *bound = search->weight;
+    }
+    if (result != 1 || !anytime || best < 0 || *bound <= 1 || search->weight <= 1) break;
+    search->weight = 1 + (search->weight - 1) / 2;
+    if (search->weight < 1 + ANYTIME_MIN_STEP) search->weight = 1;
+    check(anytime_rekey(search), "failed to rekey anytime search");
+  }
+  if (result < 0) log_info("anytime search of %lx failed, returning best solution so far", state);
+  return best;
+ error:
+  return best;
+}
+
+long anytime_reset(anytime_search *search)
+{ /* clear for next instance, and return count of states that have been discovered */
+  priorityQ_reset(search->priorityQp);
+  pool_reset(search->pool);
+  search->nboards = search->nexpanded = 0;
+  return closed_reset(search->closed);
+}
+
+void anytime_free(anytime_search *search)
+{
+  priorityQ_free(search->priorityQp);
+  closed_free(search->closed);
+  pool_free(search->pool);
+  free(search->boards);
+  free(search->expanded);
+  free(search);
+}
+
+/********************************************
+ *      OPERATIONS FOR SOLVER CONTEXT       *
+ ********************************************/
+
+/**********************************************
+ *  A solver context holds everything an engine needs to solve one
+ *  instance after another: priority queue, closed set and node pool of
+ *  astar, search stack of ida, queues and node pools of hda threads.
+ *  Contexts are not shared between threads; heuristic tables, oracle and
+ *  pattern database are read-only.
+ **********************************************/
+
+typedef struct solver_ctx {
+  int engine; /* ENGINE_ASTAR, ENGINE_IDA, ENGINE_ORACLE, ENGINE_HDA, ENGINE_BIDIR,
+		 ENGINE_WASTAR or ENGINE_ARA */
+  int (*heuristic)(unsigned long state, int nmoves);
+  int nthreads; /* threads of hda */
+  hda_search *hda; /* queues and node pools of hda threads */
+  priorityQ *priorityQp;
+  closed_set *closed;
+  node_pool *pool;
+  ida_search search;
+  bidir_search *bidir;
+  memory_bound bound; /* limits of astar with memory_budget, budget 0 if unbounded */
+  anytime_search *anytime;
+  search_budget budget; /* of wastar and ara, query_budget unless changed between solves */
+  cache_hits hits; /* entries of cached boards requeued by astar */
+} solver_ctx;
+
+typedef struct solution {
+  unsigned long state; /* initial state */
+  unsigned long goal; /* goal state of batch instance, END_STATE by default */
+  int nmoves; /* number of moves, -1 if not solved */
+  long expanded; /* number of states expanded (discovered for astar and bidir) */
+  long reexpanded; /* states expanded depth-first once the memory bound of astar was reached */
+  double bound; /* proven bound of nmoves over optimal number of moves, 1 if optimal */
+  double seconds; /* wall time of solve */
+  unsigned char moves[MAX_MOVES]; /* moves of the blank */
+#ifdef SEARCH_STATS
+  search_stats stats; /* counters of solve */
+#endif
+} solution;
+
+double wall_time(void)
+{ /* monotonic wall clock, in seconds */
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+bool state_valid(unsigned long state)
+{ /* state holds each of 0..BOARD_CELLS - 1 once */
+  int i;
+  unsigned seen = 0;
+#if BOARD_CELLS < 16
+  if (state >> (4 * BOARD_CELLS)) return false;
+#endif
+  for (i = 0; i < BOARD_CELLS; i++) {
+    unsigned tile = (state >> (4 * i)) & 0xF;
+    if (tile >= BOARD_CELLS || (seen & (1u << tile))) return false;
+    seen |= 1u << tile;
+  }
+  return true;
+}
+
+int state_parity(unsigned long state)
+{ /* parity that no move changes, so that valid states of the same parity
+     reach each other: of the tile inversions, and on boards of even width
+     of the row of the blank. a vertical move carries a tile across
+     BOARD_WIDTH - 1 others: on boards of odd width the parity of the
+     inversions never changes, on boards of even width it changes with the
+     row of the blank */
+  int i, j;
+  int inversions = 0;
+  for (i = 0; i < BOARD_CELLS; i++) {
+    unsigned tile = (state >> (4 * i)) & 0xF;
+    for (j = 0; j < i; j++) {
+      unsigned other = (state >> (4 * j)) & 0xF;
+      if (tile != 0 && other > tile) inversions++;
+    }
+  }
+#if BOARD_WIDTH % 2 == 0
+  inversions += blank_index(state) / BOARD_WIDTH;
+#endif
+  return inversions % 2;
+}
+
+bool state_solvable(unsigned long state)
+{ /* state is valid, and reaches END_STATE */
+  return state_valid(state) && state_parity(state) == state_parity(END_STATE);
+}
+
+const char *engine_names[] = { "astar", "ida", "oracle", "hda", "bidir", "wastar", "ara", NULL }; /* by ENGINE_* */
+
+int engine_by_name(const char *name)
+{ /* returns engine of given name, -1 if none */
+  int i;
+  for (i = 0; engine_names[i]; i++) {
+    if (strcmp(engine_names[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+char move_name(int move)
+{ /* letter of move of the blank */
+  return "UDLR"[move];
+}
+
+solver_ctx *solver_init(int engine, int (*heuristic)(unsigned long state, int nmoves), int nthreads)
+{ /* initialize solver context for engine; nthreads is used by hda only */
+  solver_ctx *ctx = calloc(1, sizeof(*ctx));
+  check_mem(ctx);
+  ctx->engine = engine;
+  ctx->heuristic = heuristic;
+  ctx->nthreads = nthreads;
+  if (engine == ENGINE_HDA) {
+    ctx->closed = closed_init();
+    ctx->hda = hda_init(nthreads);
+    check_mem(ctx->closed);
+    check_mem(ctx->hda);
+  }
+  if (engine == ENGINE_BIDIR) {
+    ctx->bidir = bidir_init();
+    check_mem(ctx->bidir);
+  }
+  if (engine == ENGINE_WASTAR || engine == ENGINE_ARA) {
+    ctx->anytime = anytime_init();
+    ctx->budget = query_budget;
+    check_mem(ctx->anytime);
+  }
+  if (engine == ENGINE_ASTAR) {
+    if (memory_budget > 0) {
+      check(memory_bound_init(&ctx->bound, memory_budget), "invalid memory bound");
+      ctx->closed = closed_init_bits(ctx->bound.bits);
+    } else {
+      ctx->closed = closed_init();
+    }
+    ctx->priorityQp = priorityQ_init();
+    ctx->pool = pool_init();
+    check_mem(ctx->priorityQp);
+    check_mem(ctx->closed);
+    check_mem(ctx->pool);
+  }
+  return ctx;
+ error:
+  log_info("error allocating memory for solver");
+  if (ctx) {
+    free(ctx->priorityQp);
+    if (ctx->closed) closed_free(ctx->closed);
+    free(ctx->pool);
+    if (ctx->hda) hda_free(ctx->hda);
+    free(ctx);
+  }
+  return NULL;
+}
+
+bool solver_search(solver_ctx *ctx, unsigned long state, solution *sol)
+{ /* search state with the engine of context into sol */
+  int i;
+  double start = wall_time();
+  sol->state = state;
+  sol->nmoves = -1;
+  sol->expanded = 0;
+  sol->reexpanded = 0;
+  sol->bound = 1;
+  STAT(stats_reset());
+
+  if (ctx->engine == ENGINE_ORACLE) {
+    unsigned long path[MAX_MOVES];
+    sol->nmoves = oracle_solve(state, path);
+    if (sol->nmoves < 0) {
+      log_err("oracle has no path from %0*lx to the goal", BOARD_CELLS, state);
+    } else {
+      sol->expanded = sol->nmoves + 1; /* states on the path */
+      for (i = 0; i < sol->nmoves; i++) {
+	sol->moves[i] = move_direction(path[i], path[i + 1]);
+      }
+    }
+  } else if (ctx->engine == ENGINE_HDA) {
+    for (i = 0; i < ctx->nthreads; i++) { /* expanded by all threads, before solve */
+      sol->expanded -= ctx->hda->workers[i].expanded;
+    }
+    sol->nmoves = hda_star(ctx->hda, state, ctx->closed, ctx->heuristic);
+    sol->seconds = wall_time() - start;
+    if (sol->nmoves >= 0) sol->nmoves = closed_moves(ctx->closed, END_STATE, sol->moves);
+    for (i = 0; i < ctx->nthreads; i++) {
+      sol->expanded += ctx->hda->workers[i].expanded;
+    }
+    hda_reset(ctx->hda);
+    closed_reset(ctx->closed);
+    STAT(sol->stats = stats);
+    return sol->nmoves >= 0;
+  } else if (ctx->engine == ENGINE_BIDIR) {
+    sol->nmoves = bidir_star(ctx->bidir, state, ctx->heuristic, sol->moves);
+    sol->seconds = wall_time() - start;
+    sol->expanded = bidir_reset(ctx->bidir);
+    STAT(sol->stats = stats);
+    return sol->nmoves >= 0;
+  } else if (ctx->engine == ENGINE_WASTAR || ctx->engine == ENGINE_ARA) {
+    sol->nmoves = anytime_star(ctx->anytime, state, ctx->heuristic, &ctx->budget,
+			       ctx->engine == ENGINE_ARA, sol->moves, &sol->bound);
+    sol->seconds = wall_time() - start;
+    sol->expanded = anytime_reset(ctx->anytime);
+    STAT(sol->stats = stats);
+    return sol->nmoves >= 0;
+  } else if (ctx->engine == ENGINE_IDA) {
+    sol->nmoves = ida_star(&ctx->search, state, ctx->heuristic);
+    sol->expanded = ctx->search.expanded;
+    if (sol->nmoves > 0) memcpy(sol->moves, ctx->search.moves, sol->nmoves);
+  } else {
+    puzzle *boardp = board_init(ctx->pool, state, 0); /* initialize board */
+    check_mem(boardp);
+    boardp->h_score = ctx->heuristic(state, 0);
+    check(priorityQ_insert(ctx->priorityQp, boardp, boardp->h_score), "failed to insert %lx", state);
+    closed_discover(ctx->closed, state, 0, 0, boardp->h_score);
+
+    cache_entry hit;
+    boardp = a_star(ctx->priorityQp, ctx->closed, ctx->pool, ctx->heuristic, cache, &ctx->hits, &hit,
+		    ctx->bound.budget ? &ctx->bound : NULL); /* solve the board */
+    if (boardp && boardp->state != END_STATE && !boardp->cached) { /* memory bound reached */
+      sol->nmoves = frontier_star(&ctx->search, ctx->priorityQp, ctx->closed, ctx->heuristic);
+      if (sol->nmoves >= 0) memcpy(sol->moves, ctx->search.moves, sol->nmoves);
+      sol->reexpanded = ctx->search.expanded;
+      log_info("memory bound reached on %lx: searched depth-first from %d frontier boards, %ld states expanded again",
+	       state, ctx->priorityQp->nelements, sol->reexpanded);
+    } else if (boardp) {
+      sol->nmoves = closed_moves(ctx->closed, boardp->state, sol->moves);
+    }
+    if (boardp && boardp->cached) { /* rest of solution from cache */
+      sol->nmoves += cache_moves(&hit, sol->moves + sol->nmoves);
+    }
+    sol->seconds = wall_time() - start;
+
+    priorityQ_reset(ctx->priorityQp); /* clear for next instance */
+    pool_reset(ctx->pool);
+    ctx->hits.count = 0;
+    sol->expanded = closed_reset(ctx->closed) + sol->reexpanded;
+    STAT(sol->stats = stats);
+    return sol->nmoves >= 0;
+  }
+  sol->seconds = wall_time() - start;
+  STAT(sol->stats = stats);
+  return sol->nmoves >= 0;
+ error:
+  return false;
+}
+
+bool solver_solve(solver_ctx *ctx, unsigned long state, solution *sol)
+{ /* solve state with the engine of context into sol, from the solution
+     cache if state is cached, caching the states of the solution otherwise */
+  cache_entry hit;
+  if (cache) atomic_fetch_add_explicit(&cache->queries, 1, memory_order_relaxed);
+  if (cache && cache_lookup(cache, state, &hit)) {
+    double start = wall_time();
+    sol->state = state;
+    sol->nmoves = cache_moves(&hit, sol->moves);
+    sol->expanded = sol->reexpanded = 0;
+    sol->bound = 1;
+    STAT(memset(&sol->stats, 0, sizeof(sol->stats)));
+    sol->seconds = wall_time() - start;
+    return true;
+  }
+  if (!solver_search(ctx, state, sol)) return false;
+  if (cache && sol->bound <= 1) cache_insert_path(cache, state, sol->moves, sol->nmoves);
+  return true;
+}
+
+void solver_report(solver_ctx *ctx)
+{ /* log statistics of engine over all solves */
+  int i;
+  if (ctx->engine == ENGINE_HDA) {
+    for (i = 0; i < ctx->nthreads; i++) {
+      log_info("hda thread %d: expanded %ld", i, ctx->hda->workers[i].expanded);
+    }
+  }
+}
+
+void solver_free(solver_ctx *ctx)
+{ /* free solver context */
+  if (ctx->engine == ENGINE_ASTAR) {
+    priorityQ_free(ctx->priorityQp);
+    closed_free(ctx->closed);
+    pool_free(ctx->pool);
+    free(ctx->hits.entries);
+  }
+  if (ctx->engine == ENGINE_HDA) {
+    closed_free(ctx->closed);
+    hda_free(ctx->hda);
+  }
+  if (ctx->engine == ENGINE_BIDIR) {
+    bidir_free(ctx->bidir);
+  }
+  if (ctx->anytime) anytime_free(ctx->anytime);
+  free(ctx);
+}
+
+/********************************************
+ *      OPERATIONS FOR GOAL RELABELING      *
+ ********************************************/
+
+/**********************************************
+ *  Heuristics, pattern databases, oracle and cache all measure distance
+ *  to END_STATE. A query for another goal is mapped into the frame of
+ *  END_STATE instead: moves of the blank do not depend on the numbers of
+ *  tiles, so renaming every tile to the tile END_STATE holds at its cell
+ *  of the goal turns the goal into END_STATE and the initial state into
+ *  an instance of the same distance. The blank keeps its name, so the
+ *  blank of the goal must first be brought to the last cell by mirroring
+ *  the board (which exchanges UP and DOWN, or LEFT and RIGHT): goals with
+ *  the blank in a corner can be relabeled. Other goals are searched for
+ *  directly, by IDA* with manhattan distance to the goal, without pattern
+ *  databases, oracle or cache.
+ **********************************************/
+
+#define FLIP_COLUMNS 1 /* mirror of goal frame */
+#define FLIP_ROWS 2
+
+typedef struct goal_frame {
+  int flip; /* FLIP_COLUMNS and/or FLIP_ROWS */
+  unsigned char label[16]; /* tile of END_STATE, by tile of mirrored goal */
+} goal_frame;
+
+unsigned long mirror_state(unsigned long state, int flip)
+{ /* mirror cells of board */
+  unsigned long mirrored = 0;
+  int row, col;
+  for (row = 0; row < BOARD_HEIGHT; row++) {
+    for (col = 0; col < BOARD_WIDTH; col++) {
+      int cell = (flip & FLIP_ROWS ? BOARD_HEIGHT - 1 - row : row) * BOARD_WIDTH
+	+ (flip & FLIP_COLUMNS ? BOARD_WIDTH - 1 - col : col);
+      mirrored |= ((state >> (4 * (row * BOARD_WIDTH + col))) & 0xF) << (4 * cell);
+    }
+  }
+#if BOARD_CELLS < 16
+  mirrored |= state >> (4 * BOARD_CELLS) << (4 * BOARD_CELLS); /* keep invalid bits invalid */
+#endif
+  return mirrored;
+}
+
+bool goal_frame_init(goal_frame *frame, unsigned long goal)
+{ /* frame mapping goal to END_STATE, returns false if goal is not a
+     state, or its blank is not in a corner */
+  int i, blank, row, col;
+  if (!state_valid(goal)) return false;
+  blank = blank_index(goal);
+  row = blank / BOARD_WIDTH;
+  col = blank % BOARD_WIDTH;
+  if ((row != 0 && row != BOARD_HEIGHT - 1) || (col != 0 && col != BOARD_WIDTH - 1)) return false;
+  frame->flip = (row != BOARD_HEIGHT - 1 ? FLIP_ROWS : 0) | (col != BOARD_WIDTH - 1 ? FLIP_COLUMNS : 0);
+  memset(frame->label, 0xF, sizeof(frame->label)); /* tiles off the board stay invalid */
+  goal = mirror_state(goal, frame->flip);
+  for (i = 0; i < BOARD_CELLS; i++) {
+    frame->label[(goal >> (4 * i)) & 0xF] = (END_STATE >> (4 * i)) & 0xF;
+  }
+  return true;
+}
+
+unsigned long goal_relabel(const goal_frame *frame, unsigned long state)
+{ /* state in frame of END_STATE */
+  unsigned long relabeled = 0;
+  int i;
+  state = mirror_state(state, frame->flip);
+  for (i = 0; i < BOARD_CELLS; i++) {
+    relabeled |= (unsigned long)frame->label[(state >> (4 * i)) & 0xF] << (4 * i);
+  }
+#if BOARD_CELLS < 16
+  relabeled |= state >> (4 * BOARD_CELLS) << (4 * BOARD_CELLS);
+#endif
+  return relabeled;
+}
+
+int goal_move(const goal_frame *frame, int move)
+{ /* move of blank in frame of goal, from move in frame of END_STATE */
+  bool vertical = move == MOVE_UP || move == MOVE_DOWN;
+  if (frame->flip & (vertical ? FLIP_ROWS : FLIP_COLUMNS)) return move ^ 1;
+  return move;
+}
+
+bool goal_solvable(unsigned long state, unsigned long goal)
+{ /* state and goal are states, and state reaches goal */
+  return state_valid(state) && state_valid(goal) && state_parity(state) == state_parity(goal);
+}
+
+bool goal_search(solver_ctx *ctx, unsigned long state, unsigned long goal, solution *sol)
+{ /* solve state towards goal that cannot be relabeled into sol, by IDA*
+     with manhattan distance to goal */
+  unsigned char manhattan[16][BOARD_CELLS] = { { 0 } }; /* the blank counts 0 */
+  double start = wall_time();
+  STAT(stats_reset());
+  manhattan_table_init(manhattan, goal);
+  ctx->search.heuristic = NULL;
+  ctx->search.goal = goal;
+  ctx->search.manhattan = (const unsigned char (*)[BOARD_CELLS])manhattan;
+  sol->state = state;
+  sol->nmoves = ida_iterate(&ctx->search, state, manhattan_table_distance(manhattan, state));
+  sol->expanded = ctx->search.expanded;
+  sol->reexpanded = 0;
+  sol->bound = 1;
+  if (sol->nmoves > 0) memcpy(sol->moves, ctx->search.moves, sol->nmoves);
+  sol->seconds = wall_time() - start;
+  STAT(sol->stats = stats);
+  return sol->nmoves >= 0;
+}
+
+bool solver_solve_goal(solver_ctx *ctx, unsigned long state, unsigned long goal, solution *sol)
+{ /* solve state towards goal into sol, through the tables of END_STATE if
+     goal can be relabeled; state must be goal_solvable */
+  goal_frame frame;
+  int i;
+  bool solved;
+  if (goal == END_STATE) return solver_solve(ctx, state, sol);
+  if (!goal_frame_init(&frame, goal)) return goal_search(ctx, state, goal, sol);
+  solved = solver_solve(ctx, goal_relabel(&frame, state), sol);
+  sol->state = state;
+  for (i = 0; i < sol->nmoves; i++) {
+    sol->moves[i] = goal_move(&frame, sol->moves[i]);
+  }
+  return solved;
+}
+
+/********************************************
+ *       OPERATIONS FOR BATCH SOLVER        *
+ ********************************************/
+
+/**********************************************
+ *  Instances are dealt out in contiguous ranges, one per worker thread.
+ *  A worker takes instances from the front of its own range, and once
+ *  it is empty steals the back half of another worker's range, so that
+ *  threads keep busy however uneven the instances are. Each worker has
+ *  its own solver context, and solutions are stored by instance index.
+ **********************************************/
+
+typedef struct batch_worker {
+  pthread_t thread;
+  pthread_mutex_t lock; /* guards next and end */
+  int next; /* next instance of range */
+  int end; /* end of range */
+  int id;
+  int nsolved; /* number of instances solved by worker */
+  int nstolen; /* number of steals */
+  struct batch *batchp;
+} batch_worker;
+
+typedef struct batch {
+  int ninstances;
+  solution *solutions; /* solution of each instance, in input order */
+  int nworkers;
+  batch_worker *workers;
+  int engine;
+  int (*heuristic)(unsigned long state, int nmoves);
+  int nthreads; /* threads of hda engine in each worker */
+} batch;
+
+bool batch_take(batch_worker *worker, int *index)
+{ /* take next instance from front of own range */
+  bool taken = false;
+  pthread_mutex_lock(&worker->lock);
+  if (worker->next < worker->end) {
+    *index = worker->next++;
+    taken = true;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return taken;
+}
+
+bool batch_steal(batch_worker *worker, int *index)
+{ /* steal back half of the range of another worker, keeping its first instance */
+  batch *batchp = worker->batchp;
+  int i;
+  for (i = 1; i < batchp->nworkers; i++) {
+    batch_worker *victim = &batchp->workers[(worker->id + i) % batchp->nworkers];
+    int start = -1, end = 0;
+    pthread_mutex_lock(&victim->lock);
+    if (victim->next < victim->end) {
+      end = victim->end;
+      start = victim->end - (victim->end - victim->next + 1) / 2;
+      victim->end = start;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    if (start < 0) continue;
+
+    pthread_mutex_lock(&worker->lock);
+    worker->next = start + 1;
+    worker->end = end;
+    pthread_mutex_unlock(&worker->lock);
+    worker->nstolen++;
+    *index = start;
+    return true;
+  }
+  return false;
+}
+
+void *batch_run(void *arg)
+{ /* worker thread: solve instances until none are left to take or steal */
+  batch_worker *worker = arg;
+  batch *batchp = worker->batchp;
+  solver_ctx *ctx = solver_init(batchp->engine, batchp->heuristic, batchp->nthreads);
+  int index;
+  check_mem(ctx);
+
+  while (batch_take(worker, &index) || batch_steal(worker, &index)) {
+    solution *sol = &batchp->solutions[index];
+    if (!solver_solve_goal(ctx, sol->state, sol->goal, sol)) log_info("failed to solve %lx", sol->state);
+    worker->nsolved++;
+  }
+  solver_report(ctx);
+  solver_free(ctx);
+  return NULL;
+ error:
+  return NULL;
+}
+
+bool batch_solve(batch *batchp)
+{ /* solve all instances of batch on its worker threads */
+  int i;
+  int nstarted = 0;
+  batchp->workers = calloc(batchp->nworkers, sizeof(batch_worker));
+  check_mem(batchp->workers);
+  for (i = 0; i < batchp->nworkers; i++) { /* deal out instances evenly */
+    batch_worker *worker = &batchp->workers[i];
+    worker->id = i;
+    worker->batchp = batchp;
+    worker->next = (long)batchp->ninstances * i / batchp->nworkers;
+    worker->end = (long)batchp->ninstances * (i + 1) / batchp->nworkers;
+    pthread_mutex_init(&worker->lock, NULL);
+  }
+  for (i = 0; i < batchp->nworkers; i++) {
+    check(pthread_create(&batchp->workers[i].thread, NULL, batch_run, &batchp->workers[i]) == 0,
+	  "failed to start worker %d", i);
+    nstarted++;
+  }
+  for (i = 0; i < nstarted; i++) {
+    pthread_join(batchp->workers[i].thread, NULL);
+  }
+  return true;
+ error:
+  for (i = 0; i < nstarted; i++) { /* remaining instances are stolen by started workers */
+    pthread_join(batchp->workers[i].thread, NULL);
+  }
+  return nstarted > 0;
+}
+
+void batch_free(batch *batchp)
 {
-  if (priorityQp->nelements == 0) { /* no elements to extract */
-    log_info("error: no elements in the priority queue");
-    return NULL;
+  int i;
+  if (batchp->workers) {
+    for (i = 0; i < batchp->nworkers; i++) {
+      pthread_mutex_destroy(&batchp->workers[i].lock);
+    }
   }
-  puzzle *boardp = a_star_step(priorityQp, closed, heuristic); /* extract first processed state */
-  puzzle *temp = boardp;
-  while (boardp->state != END_STATE)
-    {
-      if (priorityQp->nelements == 0) { /* no elements to extract */
-	log_info("error: no elements in the priority queue");
-	return NULL;
+  free(batchp->workers);
+  free(batchp->solutions);
+}
+
+int read_instances(const char *path, solution **solutions)
+{ /* read instances from path, one hexadecimal state per line, optionally
+     followed by a goal state ('#' starts a comment), returns number of
+     instances, -1 on error */
+  char line[256];
+  int n = 0, capacity = 0;
+  FILE *file = fopen(path, "r");
+  *solutions = NULL;
+  check(file, "failed to open %s", path);
+  while (fgets(line, sizeof(line), file)) {
+    char *end;
+    unsigned long state, goal;
+    char *start = line + strspn(line, " \t");
+    if (*start == '#' || *start == '\n' || *start == '\0') continue;
+    state = strtoul(start, &end, 16);
+    start = end + strspn(end, " \t");
+    goal = *start == '#' || *start == '\n' || *start == '\0' ? END_STATE : strtoul(start, &end, 16);
+    check(goal_solvable(state, goal), "invalid or unsolvable instance in %s: %s", path, line);
+    if (n == capacity) {
+      solution *grown;
+      capacity = capacity ? 2 * capacity : 1024;
+      grown = realloc(*solutions, capacity * sizeof(solution));
+      check_mem(grown);
+      *solutions = grown;
+    }
+    (*solutions)[n].state = state;
+    (*solutions)[n++].goal = goal;
+  }
+  fclose(file);
+  return n;
+ error:
+  if (file) fclose(file);
+  free(*solutions);
+  *solutions = NULL;
+  return -1;
+}
+
+void print_solution(FILE *out, const solution *sol)
+{ /* print initial state, number of moves, expanded states and moves of the blank,
+     followed by the proven bound over optimal of a solution not proven optimal */
+  int i;
+  fprintf(out, "%0*lx %d %ld ", BOARD_CELLS, sol->state, sol->nmoves, sol->expanded);
+  for (i = 0; i < sol->nmoves; i++) {
+    fputc(move_name(sol->moves[i]), out);
+  }
+  if (sol->nmoves >= 0 && sol->bound > 1) fprintf(out, " %.3f", sol->bound);
+  fputc('\n', out);
+}
+
+#ifdef SEARCH_STATS
+double stats_ms(long ns)
+{ /* milliseconds of sampled time, which may come out below 0 for cheap operations */
+  return ns > 0 ? ns * 1e-6 : 0;
+}
+
+void print_stats(FILE *out, const solution *sol)
+{ /* print counters of solve as a JSON object on one line */
+  const search_stats *st = &sol->stats;
+  fprintf(out, "{\"state\": \"%0*lx\", \"nmoves\": %d, \"bound\": %.3f, \"seconds\": %.6f, "
+	  "\"expanded\": %ld, \"reexpanded\": %ld, \"generated\": %ld, \"duplicates\": %ld, \"improved\": %ld, "
+	  "\"reopened\": %ld, \"stale\": %ld, \"lookups\": %ld, "
+	  "\"mean_probes\": %.3f, \"max_probes\": %ld, \"mean_buckets\": %.2f, "
+	  "\"max_buckets\": %ld, \"max_queued\": %ld, \"ms_heuristic\": %.3f, "
+	  "\"ms_successors\": %.3f, \"ms_queue\": %.3f, \"ms_closed\": %.3f}\n",
+	  BOARD_CELLS, sol->state, sol->nmoves, sol->bound, sol->seconds,
+	  st->expanded, sol->reexpanded, st->generated, st->duplicates, st->improved, st->reopened,
+	  st->stale, st->lookups,
+	  st->lookups ? (double)st->probes / st->lookups : 0, st->max_probes,
+	  st->queue_samples ? (double)st->queue_buckets / st->queue_samples : 0, st->max_buckets,
+	  st->max_queued, stats_ms(st->ns_heuristic), stats_ms(st->ns_successors),
+	  stats_ms(st->ns_queue), stats_ms(st->ns_closed));
+}
+#endif
+
+/********************************************
+ *       OPERATIONS FOR SOLVER SERVER       *
+ ********************************************/
+
+/**********************************************
+ *  A long-lived process solves a stream of requests with warm solver
+ *  contexts and tables loaded once. Each request is a line holding a
+ *  hexadecimal state, optionally followed by a goal state (see
+ *  solver_solve_goal), and gets a response line, in order: the solution
+ *  as printed by print_solution, "STATE unsolvable" if the parity of the
+ *  state rules out the goal (checked before any search), or "TEXT
+ *  invalid". A reader thread parses requests into a ring while the
+ *  solver works through them, so reading the next requests overlaps
+ *  solving, and responses are flushed whenever the ring runs empty.
+ *
+ *  The server reads stdin (-r), or accepts connections on a Unix socket
+ *  (-u), one thread per connection, taking solver contexts from a pool
+ *  of idle ones.
+ **********************************************/
+
+#define SERVER_RING 256 /* requests read ahead of the solver */
+
+typedef struct server_request {
+  unsigned long state;
+  unsigned long goal; /* END_STATE unless given after state */
+  bool valid; /* line holds a state */
+  char text[24]; /* start of line, for invalid requests */
+} server_request;
+
+typedef struct server_stream {
+  FILE *in, *out;
+  pthread_mutex_t lock; /* guards ring, count and eof */
+  pthread_cond_t readable; /* ring is not empty, or eof */
+  pthread_cond_t writable; /* ring is not full */
+  server_request ring[SERVER_RING];
+  int head; /* next request to solve */
+  int count; /* requests in ring */
+  bool eof;
+} server_stream;
+
+typedef struct server {
+  pthread_mutex_t lock; /* guards idle contexts */
+  solver_ctx **idle; /* contexts not in use */
+  int nidle, capacity;
+  int engine;
+  int (*heuristic)(unsigned long state, int nmoves);
+  int nthreads; /* threads of hda engine in each context */
+} server;
+
+typedef struct server_connection {
+  int fd;
+  server *serverp;
+} server_connection;
+
+void server_parse(const char *line, server_request *request)
+{ /* parse request line: hexadecimal state, optionally followed by
+     hexadecimal goal state, surrounded by blanks */
+  char *end;
+  line += strspn(line, " \t");
+  snprintf(request->text, sizeof(request->text), "%.*s", (int)strcspn(line, "\r\n"), line);
+  request->state = strtoul(line, &end, 16);
+  request->goal = END_STATE;
+  request->valid = end != line;
+  line = end + strspn(end, " \t\r\n");
+  if (request->valid && *line != '\0') {
+    request->goal = strtoul(line, &end, 16);
+    request->valid = end != line;
+  }
+  request->valid = request->valid && end[strspn(end, " \t\r\n")] == '\0';
+}
+
+void *server_read(void *arg)
+{ /* reader thread: parse request lines into ring until end of input */
+  server_stream *stream = arg;
+  char line[256];
+  while (fgets(line, sizeof(line), stream->in)) {
+    server_request *request;
+    if (line[strspn(line, " \t\r\n")] == '\0') continue; /* blank line */
+    pthread_mutex_lock(&stream->lock);
+    while (stream->count == SERVER_RING) pthread_cond_wait(&stream->writable, &stream->lock);
+    request = &stream->ring[(stream->head + stream->count) % SERVER_RING];
+    pthread_mutex_unlock(&stream->lock);
+    server_parse(line, request); /* slot is not seen by solver until counted */
+
+    pthread_mutex_lock(&stream->lock);
+    stream->count++;
+    pthread_cond_signal(&stream->readable);
+    pthread_mutex_unlock(&stream->lock);
+  }
+  pthread_mutex_lock(&stream->lock);
+  stream->eof = true;
+  pthread_cond_signal(&stream->readable);
+  pthread_mutex_unlock(&stream->lock);
+  return NULL;
+}
+
+bool server_stream_run(solver_ctx *ctx, FILE *in, FILE *out)
+{ /* answer requests of in on out, in order, until end of input */
+  server_stream stream = { .in = in, .out = out };
+  pthread_t reader;
+  pthread_mutex_init(&stream.lock, NULL);
+  pthread_cond_init(&stream.readable, NULL);
+  pthread_cond_init(&stream.writable, NULL);
+  check(pthread_create(&reader, NULL, server_read, &stream) == 0, "failed to start reader");
+
+  while (true) {
+    server_request request;
+    solution sol;
+    bool drained;
+    pthread_mutex_lock(&stream.lock);
+    while (stream.count == 0 && !stream.eof) pthread_cond_wait(&stream.readable, &stream.lock);
+    if (stream.count == 0) {
+      pthread_mutex_unlock(&stream.lock);
+      break;
+    }
+    request = stream.ring[stream.head];
+    stream.head = (stream.head + 1) % SERVER_RING;
+    drained = --stream.count == 0;
+    pthread_cond_signal(&stream.writable);
+    pthread_mutex_unlock(&stream.lock);
+
+    if (!request.valid) {
+      fprintf(out, "%s invalid\n", request.text);
+    } else if (!goal_solvable(request.state, request.goal)) {
+      fprintf(out, "%0*lx unsolvable\n", BOARD_CELLS, request.state);
+    } else {
+      solver_solve_goal(ctx, request.state, request.goal, &sol);
+      print_solution(out, &sol);
+      STAT(print_stats(stderr, &sol));
+    }
+    if (drained) fflush(out); /* no request waiting, answer now */
+  }
+  fflush(out);
+  pthread_join(reader, NULL);
+  pthread_cond_destroy(&stream.readable);
+  pthread_cond_destroy(&stream.writable);
+  pthread_mutex_destroy(&stream.lock);
+  return true;
+ error:
+  pthread_cond_destroy(&stream.readable);
+  pthread_cond_destroy(&stream.writable);
+  pthread_mutex_destroy(&stream.lock);
+  return false;
+}
+
+solver_ctx *server_take(server *serverp)
+{ /* take an idle solver context, or initialize one */
+  solver_ctx *ctx = NULL;
+  pthread_mutex_lock(&serverp->lock);
+  if (serverp->nidle > 0) ctx = serverp->idle[--serverp->nidle];
+  pthread_mutex_unlock(&serverp->lock);
+  if (ctx == NULL) ctx = solver_init(serverp->engine, serverp->heuristic, serverp->nthreads);
+  return ctx;
+}
+
+void server_give(server *serverp, solver_ctx *ctx)
+{ /* return solver context to the idle ones */
+  pthread_mutex_lock(&serverp->lock);
+  if (serverp->nidle == serverp->capacity) {
+    int capacity = serverp->capacity ? 2 * serverp->capacity : 8;
+    solver_ctx **grown = realloc(serverp->idle, capacity * sizeof(*grown));
+    if (grown == NULL) {
+      pthread_mutex_unlock(&serverp->lock);
+      solver_free(ctx);
+      return;
+    }
+    serverp->idle = grown;
+    serverp->capacity = capacity;
+  }
+  serverp->idle[serverp->nidle++] = ctx;
+  pthread_mutex_unlock(&serverp->lock);
+}
+
+void *server_connection_run(void *arg)
+{ /* connection thread: answer requests of one client */
+  server_connection *connection = arg;
+  solver_ctx *ctx = server_take(connection->serverp);
+  FILE *in = fdopen(connection->fd, "r");
+  FILE *out = NULL;
+  int fd = dup(connection->fd);
+  if (fd >= 0) out = fdopen(fd, "w");
+  check(ctx && in && out, "failed to set up connection");
+  server_stream_run(ctx, in, out);
+ error:
+  if (ctx) server_give(connection->serverp, ctx);
+  if (out) {
+    fclose(out);
+  } else if (fd >= 0) {
+    close(fd);
+  }
+  if (in) {
+    fclose(in);
+  } else {
+    close(connection->fd);
+  }
+  free(connection);
+  return NULL;
+}
+
+bool serve_stdin(int engine, int (*heuristic)(unsigned long state, int nmoves), int nthreads)
+{ /* answer requests of stdin on stdout */
+  solver_ctx *ctx = solver_init(engine, heuristic, nthreads);
+  bool served;
+  check_mem(ctx);
+  served = server_stream_run(ctx, stdin, stdout);
+  solver_free(ctx);
+  return served;
+ error:
+  return false;
+}
+
+bool serve_socket(const char *path, int engine, int (*heuristic)(unsigned long state, int nmoves), int nthreads)
+{ /* accept connections on Unix socket at path, answering each on its own thread */
+  server serverp = { .engine = engine, .heuristic = heuristic, .nthreads = nthreads };
+  struct sockaddr_un address = { .sun_family = AF_UNIX };
+  int fd = -1;
+  check(strlen(path) < sizeof(address.sun_path), "socket path too long: %s", path);
+  strcpy(address.sun_path, path);
+  pthread_mutex_init(&serverp.lock, NULL);
+  signal(SIGPIPE, SIG_IGN); /* clients hanging up fail writes instead */
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  check(fd >= 0, "failed to create socket");
+  unlink(path);
+  check(bind(fd, (struct sockaddr *)&address, sizeof(address)) == 0, "failed to bind %s", path);
+  check(listen(fd, 64) == 0, "failed to listen on %s", path);
+  log_info("serving on %s", path);
+
+  while (true) {
+    pthread_t thread;
+    server_connection *connection;
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) {
+      if (errno == EINTR) continue;
+      log_err("failed to accept connection");
+      break;
+    }
+    connection = malloc(sizeof(*connection));
+    if (connection == NULL) {
+      close(client);
+      continue;
+    }
+    connection->fd = client;
+    connection->serverp = &serverp;
+    if (pthread_create(&thread, NULL, server_connection_run, connection) != 0) {
+      log_err("failed to start connection thread");
+      close(client);
+      free(connection);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+ error:
+  if (fd >= 0) close(fd);
+  return false;
+}
+
+/********************************************
+ *      OPERATIONS FOR INSTANCE GENERATION  *
+ ********************************************/
+
+/**********************************************
+ *  Instances are written one hexadecimal state per line, as read by -f.
+ *  Random instances are uniform over solvable states (random_state).
+ *  Instances of an exact optimal depth are drawn uniformly from the
+ *  states at that depth of the distance table, on boards small enough
+ *  to rank; on larger boards, from walks of that many moves that never
+ *  undo the last one, kept if the reference solve finds no shorter path.
+ **********************************************/
+
+#define GENERATE_ATTEMPTS 10000 /* walks per instance before giving up on a depth */
+
+solver_ctx *reference_init(void)
+{ /* solver context of optimal reference solves: oracle if loaded,
+     else ida with pattern database if loaded, else linear conflicts */
+  if (oracle) return solver_init(ENGINE_ORACLE, oracle_heuristic, 1);
+  return solver_init(ENGINE_IDA, pdb.map ? pdb_heuristic : linear_conflict_heuristic, 1);
+}
+
+#if BOARD_RANKED
+bool depth_states(int depth, unsigned long states[], int n)
+{ /* fill states with n uniformly random states at exact optimal depth */
+  unsigned char *distance = distance_table();
+  int *ranks = NULL; /* ranks of states at depth */
+  int nranks = 0;
+  int rank, i;
+  check(distance, "failed to build distance table");
+  ranks = malloc(PERMUTATIONS * sizeof(int));
+  check_mem(ranks);
+  for (rank = 0; rank < PERMUTATIONS; rank++) {
+    if (distance[rank] == depth) ranks[nranks++] = rank;
+  }
+  check(nranks > 0, "no state at depth %d", depth);
+  for (i = 0; i < n; i++) {
+    states[i] = state_unrank(ranks[random_next() % nranks]);
+  }
+  free(distance);
+  free(ranks);
+  return true;
+ error:
+  free(distance);
+  free(ranks);
+  return false;
+}
+#else
+bool depth_states(int depth, unsigned long states[], int n)
+{ /* fill states with n random states at exact optimal depth, from walks */
+  solver_ctx *reference = reference_init();
+  int i;
+  check_mem(reference);
+  check(depth >= 0 && depth < MAX_MOVES, "depth must be in [0, %d)", MAX_MOVES);
+  for (i = 0; i < n; i++) {
+    int attempt;
+    for (attempt = 0; attempt < GENERATE_ATTEMPTS; attempt++) {
+      solution sol;
+      unsigned long state = END_STATE, previous = END_STATE;
+      int step;
+      for (step = 0; step < depth; step++) {
+	unsigned long child[4];
+	int nchildren = enum_states(state, child);
+	unsigned long next;
+	do {
+	  next = child[random_next() % nchildren];
+	} while (step > 0 && next == previous);
+	previous = state;
+	state = next;
+      }
+      check(solver_solve(reference, state, &sol), "failed to solve %lx", state);
+      if (sol.nmoves == depth) {
+	states[i] = state;
+	break;
       }
-      boardp= a_star_step(priorityQp, closed, heuristic);
-      free(temp); /* free previous board */
-      temp = boardp;
     }
-  return boardp;
+    check(attempt < GENERATE_ATTEMPTS, "no state at depth %d after %d walks", depth, attempt);
+  }
+  solver_free(reference);
+  return true;
+ error:
+  if (reference) solver_free(reference);
+  return false;
+}
+#endif
+
+bool generate_instances(const char *path, int ninstances, int depth)
+{ /* write ninstances random instances to path, all at optimal depth if
+     depth >= 0 */
+  unsigned long *states = malloc((ninstances > 0 ? ninstances : 1) * sizeof(unsigned long));
+  unsigned long seed = random_seed;
+  FILE *file = NULL;
+  int i;
+  check_mem(states);
+  if (depth >= 0) {
+    check(depth_states(depth, states, ninstances), "failed to generate instances");
+  } else {
+    for (i = 0; i < ninstances; i++) {
+      states[i] = random_state();
+    }
+  }
+  file = fopen(path, "w");
+  check(file, "failed to open %s", path);
+  if (depth >= 0) {
+    fprintf(file, "# %d instances at depth %d, seed %lu\n", ninstances, depth, seed);
+  } else {
+    fprintf(file, "# %d random instances, seed %lu\n", ninstances, seed);
+  }
+  for (i = 0; i < ninstances; i++) {
+    fprintf(file, "%0*lx\n", BOARD_CELLS, states[i]);
+  }
+  i = fclose(file);
+  file = NULL;
+  check(i == 0, "failed to close %s", path);
+  free(states);
+  return true;
+ error:
+  if (file) fclose(file);
+  free(states);
+  return false;
+}
+
+
+/********************************************
+ *         OPERATIONS FOR BENCHMARK         *
+ ********************************************/
+
+/**********************************************
+ *  The benchmark solves one set of instances with every engine and
+ *  heuristic, or those given by -e and -H. Instances are random ones of
+ *  a fixed seed (-R), or read from a file, and are bucketed by optimal
+ *  depth, as found by a reference solve (oracle if loaded, else ida).
+ *  Each engine and heuristic runs in a child process, so that peak
+ *  resident memory is its own, and reports for all instances and for
+ *  each bucket: latency percentiles by wall clock, mean expanded states,
+ *  expanded states per second, and solutions that are not optimal.
+ *  IDA* is left out with no or misplaced tile heuristic unless asked
+ *  for, as it takes exponential time on deep instances.
+ **********************************************/
+
+#define BENCH_BUCKET 4 /* optimal depths per bucket */
+#define BENCH_INSTANCES 200 /* default number of random instances */
+
+typedef struct bench_row {
+  int engine;
+  int heuristic; /* index into heuristics[], -1 for oracle engine */
+  int depth_min, depth_max; /* bucket of optimal depths, -1 for all instances */
+  int ninstances;
+  int nwrong; /* solutions not of optimal length */
+  double p50, p90, p99, max; /* latency, in seconds */
+  double expanded; /* mean expanded states */
+  double rate; /* expanded states per second */
+  long peak_rss; /* peak resident memory of process, in KB */
+} bench_row;
+
+int compare_doubles(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+double percentile(const double sorted[], int n, int p)
+{ /* nearest-rank p-th percentile of n sorted values */
+  int rank = (p * n + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void bench_bucket(bench_row *row, const solution sols[], const int depth[], int n, double latency[])
+{ /* fill row with statistics of instances in bucket of row */
+  long expanded = 0;
+  double seconds = 0;
+  int i;
+  row->ninstances = row->nwrong = 0;
+  for (i = 0; i < n; i++) {
+    if (row->depth_min >= 0 && (depth[i] < row->depth_min || depth[i] > row->depth_max)) continue;
+    latency[row->ninstances++] = sols[i].seconds;
+    if (sols[i].nmoves != depth[i]) row->nwrong++;
+    expanded += sols[i].expanded;
+    seconds += sols[i].seconds;
+  }
+  if (row->ninstances == 0) return;
+  qsort(latency, row->ninstances, sizeof(double), compare_doubles);
+  row->p50 = percentile(latency, row->ninstances, 50);
+  row->p90 = percentile(latency, row->ninstances, 90);
+  row->p99 = percentile(latency, row->ninstances, 99);
+  row->max = latency[row->ninstances - 1];
+  row->expanded = (double)expanded / row->ninstances;
+  row->rate = seconds > 0 ? expanded / seconds : 0;
+}
+
+void bench_run(int fd, solution sols[], const int depth[], int n,
+	       int engine, int heuristic, int nthreads)
+{ /* child process: solve instances with engine and heuristic, and write
+     rows for all instances and each bucket to fd */
+  solver_ctx *ctx = solver_init(engine, heuristic >= 0 ? heuristics[heuristic].function :
+				manhattan_distance_heuristic, nthreads);
+  double *latency = malloc(n * sizeof(double));
+  bench_row row = { .engine = engine, .heuristic = heuristic };
+  struct rusage usage;
+  int i, max_depth = 0;
+  check_mem(ctx);
+  check_mem(latency);
+  for (i = 0; i < n; i++) {
+    solver_solve(ctx, sols[i].state, &sols[i]);
+    if (depth[i] > max_depth) max_depth = depth[i];
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  row.peak_rss = usage.ru_maxrss;
+
+  row.depth_min = row.depth_max = -1;
+  bench_bucket(&row, sols, depth, n, latency);
+  check(write(fd, &row, sizeof(row)) == sizeof(row), "failed to write benchmark");
+  for (row.depth_min = 0; row.depth_min <= max_depth; row.depth_min += BENCH_BUCKET) {
+    row.depth_max = row.depth_min + BENCH_BUCKET - 1;
+    bench_bucket(&row, sols, depth, n, latency);
+    if (row.ninstances == 0) continue;
+    check(write(fd, &row, sizeof(row)) == sizeof(row), "failed to write benchmark");
+  }
+ error:
+  free(latency);
+  if (ctx) solver_free(ctx);
+}
+
+void bench_print(FILE *out, const bench_row *row, bool json, bool first)
+{ /* print row as CSV line or JSON object */
+  char depth[16] = "all";
+  if (row->depth_min >= 0) snprintf(depth, sizeof(depth), "%d-%d", row->depth_min, row->depth_max);
+  if (json) {
+    fprintf(out, "%s\n  {\"engine\": \"%s\", \"heuristic\": \"%s\", \"depth\": \"%s\", "
+	    "\"instances\": %d, \"wrong\": %d, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+	    "\"p99_ms\": %.3f, \"max_ms\": %.3f, \"mean_expanded\": %.1f, "
+	    "\"expanded_per_s\": %.0f, \"peak_rss_kb\": %ld}", first ? "" : ",",
+	    engine_names[row->engine], row->heuristic >= 0 ? heuristics[row->heuristic].name : "-",
+	    depth, row->ninstances, row->nwrong, row->p50 * 1e3, row->p90 * 1e3, row->p99 * 1e3,
+	    row->max * 1e3, row->expanded, row->rate, row->peak_rss);
+    return;
+  }
+  fprintf(out, "%s,%s,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.1f,%.0f,%ld\n",
+	  engine_names[row->engine], row->heuristic >= 0 ? heuristics[row->heuristic].name : "-",
+	  depth, row->ninstances, row->nwrong, row->p50 * 1e3, row->p90 * 1e3, row->p99 * 1e3,
+	  row->max * 1e3, row->expanded, row->rate, row->peak_rss);
+}
+
+bool bench_fork(solution sols[], const int depth[], int n, int engine, int heuristic,
+		int nthreads, bool json, bool *first)
+{ /* run engine and heuristic in a child process, and print its rows */
+  bench_row row;
+  pid_t pid;
+  int fds[2];
+  check(pipe(fds) == 0, "failed to create pipe");
+  fflush(stdout);
+  pid = fork();
+  check(pid >= 0, "failed to fork");
+  if (pid == 0) {
+    close(fds[0]);
+    bench_run(fds[1], sols, depth, n, engine, heuristic, nthreads);
+    _exit(0);
+  }
+  close(fds[1]);
+  while (read(fds[0], &row, sizeof(row)) == sizeof(row)) {
+    bench_print(stdout, &row, json, *first);
+    *first = false;
+  }
+  close(fds[0]);
+  waitpid(pid, NULL, 0);
+  return true;
+ error:
+  return false;
+}
+
+bool run_bench(const char *path, int ninstances, int nthreads, int engine,
+	       int (*heuristic)(unsigned long state, int nmoves), bool json)
+{ /* benchmark engine and heuristic (all if engine < 0, heuristic NULL) on
+     instances read from path, or ninstances random ones */
+  solution *sols = NULL;
+  int *depth = NULL;
+  solver_ctx *reference = NULL;
+  bool first = true;
+  int i, e, h;
+  if (path) {
+    ninstances = read_instances(path, &sols);
+    check(ninstances >= 0, "failed to read instances");
+  } else {
+    if (ninstances <= 0) ninstances = BENCH_INSTANCES;
+    sols = malloc(ninstances * sizeof(solution));
+    check_mem(sols);
+    for (i = 0; i < ninstances; i++) {
+      sols[i].state = random_state();
+    }
+  }
+  depth = malloc(ninstances * sizeof(int));
+  check_mem(depth);
+
+  /* optimal depths by reference solve */
+  reference = reference_init();
+  check_mem(reference);
+  for (i = 0; i < ninstances; i++) {
+    solution sol;
+    check(solver_solve(reference, sols[i].state, &sol), "failed to solve %lx", sols[i].state);
+    depth[i] = sol.nmoves;
+  }
+  solver_free(reference);
+  reference = NULL;
+
+  if (json) {
+    printf("[");
+  } else {
+    printf("engine,heuristic,depth,instances,wrong,p50_ms,p90_ms,p99_ms,max_ms,"
+	   "mean_expanded,expanded_per_s,peak_rss_kb\n");
+  }
+  for (e = 0; engine_names[e]; e++) {
+    if (engine >= 0 && e != engine) continue;
+    if (e == ENGINE_ORACLE) { /* no heuristic */
+      if (oracle) check(bench_fork(sols, depth, ninstances, e, -1, nthreads, json, &first),
+			"failed to run benchmark");
+      continue;
+    }
+    for (h = 0; heuristics[h].name; h++) {
+      int (*function)(unsigned long state, int nmoves) = heuristics[h].function;
+      if (heuristic && function != heuristic) continue;
+      if (function == oracle_heuristic && !oracle) continue;
+      if (function == pdb_heuristic && !pdb.map) continue;
+      if (e == ENGINE_IDA && !heuristic &&
+	  (function == no_heuristic || function == misplaced_tile_heuristic)) continue;
+      check(bench_fork(sols, depth, ninstances, e, h, nthreads, json, &first),
+	    "failed to run benchmark");
+    }
+  }
+  if (json) printf("\n]\n");
+  free(sols);
+  free(depth);
+  return true;
+ error:
+  if (reference) solver_free(reference);
+  free(sols);
+  free(depth);
+  return false;
+}
+
+void usage(const char *program)
+{
+  fprintf(stderr, "usage: %s [-b oracle_file] [-o oracle_file] [-B pdb_file [-s spec]] [-p pdb_file]\n"
+	  "          [-e astar|ida|hda|bidir|wastar|ara|oracle] [-H heuristic] [-f instances_file | -n count | -r | -u socket]\n"
+	  "          [-m csv|json] [-R seed] [-g file [-d depth]] [-c entries] [-M bytes]\n"
+	  "          [-w weight] [-T seconds] [-X expansions] [-x dir [-d depth]] [-t threads]\n"
+	  "  -b FILE  build exact-distance oracle into FILE and exit\n"
+	  "  -o FILE  load exact-distance oracle from FILE, used as heuristic by astar\n"
+	  "  -B FILE  build pattern database into FILE and exit\n"
+	  "  -s SPEC  board and disjoint tile groups of pattern database to build,\n"
+	  "           default " PDB_DEFAULT ", e.g. 4x4:1,2,3,4,5/6,7,8,9,10/11,12,13,14,15\n"
+	  "  -p FILE  load pattern database from FILE, used as heuristic by astar\n"
+	  "  -e NAME  search engine: astar (default), ida, hda (parallel astar on -t threads),\n"
+	  "           bidir (bidirectional MM), wastar (weighted astar), ara (anytime: wastar\n"
+	  "           of weight lowered to 1 while the budget lasts), or oracle for greedy descent\n"
+	  "  -H NAME  heuristic of every engine but oracle (forward for bidir): none, misplaced,\n"
+	  "           manhattan (default), linear, walking, oracle (default with -o) or pdb (default with -p)\n"
+	  "  -f FILE  solve instances of FILE (one hexadecimal state per line, optionally followed\n"
+	  "           by a goal state) in a batch\n"
+	  "  -n N     solve N random instances in a batch\n"
+	  "  -r       serve requests of stdin (one hexadecimal state per line, optionally followed\n"
+	  "           by a goal state), answering on stdout\n"
+	  "  -u FILE  serve requests of connections to Unix socket FILE, as -r\n"
+	  "  -m FMT   benchmark every engine and heuristic (or those of -e, -H) on instances of -f,\n"
+	  "           or -n random ones (default %d), by optimal depth; prints csv or json\n"
+	  "  -R SEED  seed of random instances, default 1\n"
+	  "  -g FILE  write -n uniformly random instances (default %d) to FILE and exit\n"
+	  "  -d N     with -g, only instances of optimal depth N; with -x, last layer\n"
+	  "  -c N     cache optimal solutions of N states across solves; astar also stops\n"
+	  "           at cached states\n"
+	  "  -w W     weight of heuristic of wastar and ara, 1 to 3, default 2; solutions are\n"
+	  "           printed with their proven bound over optimal, if above 1\n"
+	  "  -T S     wall time budget of each query of wastar and ara, in seconds\n"
+	  "  -X N     budget of expansions of each query of wastar and ara\n"
+	  "  -M N     bound memory of astar to N bytes (suffix k, m or g), searching depth-first\n"
+	  "           from its frontier once the bound is reached; with -x, memory of runs\n"
+	  "  -x DIR   enumerate states by distance to the goal on disk, one file of sorted\n"
+	  "           states per layer in DIR, resuming after its last layer, and exit; with -B,\n"
+	  "           search groups of the pattern database that need more than -M on disk in DIR\n"
+	  "  -t N     number of threads of batch or hda, default number of processors\n"
+	  "without -f or -n, solves %d random instances and reports average time and expanded states\n",
+	  program, BENCH_INSTANCES, ITERATIONS, ITERATIONS);
 }
 
+bool run_batch(const char *path, int ninstances, int nthreads,
+	       int engine, int (*heuristic)(unsigned long state, int nmoves))
+{ /* solve batch of instances read from path, or ninstances random ones,
+     print solutions in input order, and report throughput */
+  batch batchp = { 0 };
+  double start, seconds;
+  long expanded = 0;
+  int i;
+  if (path) {
+    ninstances = read_instances(path, &batchp.solutions);
+    check(ninstances >= 0, "failed to read instances");
+  } else {
+    batchp.solutions = malloc(ninstances * sizeof(solution));
+    check_mem(batchp.solutions);
+    for (i = 0; i < ninstances; i++) {
+      batchp.solutions[i].state = random_state();
+      batchp.solutions[i].goal = END_STATE;
+    }
+  }
+  batchp.ninstances = ninstances;
+  batchp.nworkers = nthreads < ninstances ? nthreads : (ninstances > 0 ? ninstances : 1);
+  if (engine == ENGINE_HDA) { /* threads solve each instance together */
+    batchp.nworkers = 1;
+  }
+  batchp.nthreads = nthreads;
+  batchp.engine = engine;
+  batchp.heuristic = heuristic;
+
+  start = wall_time();
+  check(batch_solve(&batchp), "failed to solve batch");
+  seconds = wall_time() - start;
+
+  for (i = 0; i < ninstances; i++) {
+    print_solution(stdout, &batchp.solutions[i]);
+    STAT(print_stats(stderr, &batchp.solutions[i]));
+    expanded += batchp.solutions[i].expanded;
+  }
+  for (i = 0; i < batchp.nworkers; i++) {
+    log_info("thread %d: solved %d, stole %d times", i, batchp.workers[i].nsolved, batchp.workers[i].nstolen);
+  }
+  if (ninstances > 0) {
+    log_info("solved %d instances on %d threads in %lfs: %.0lf instances/s, %.0lf expanded/s",
+	     ninstances, batchp.nworkers, seconds, ninstances / seconds, expanded / seconds);
+  } else {
+    log_info("no instances to solve");
+  }
+  batch_free(&batchp);
+  return true;
+ error:
+  batch_free(&batchp);
+  return false;
+}
 
 int main(int argc, char *argv[])
 {
  
-  srand(time(NULL));
+  neighbors_init();
+  symmetry_init();
+  heuristics_init();
+
+  int opt;
+  int engine = ENGINE_ASTAR;
+  const char *instances_path = NULL; /* batch of instances to solve */
+  int ninstances = 0; /* number of random instances to solve in batch */
+  int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *pdb_path = NULL; /* pattern database to build */
+  const char *pdb_spec = PDB_DEFAULT;
+  bool serve = false; /* answer requests of stdin */
+  const char *bench_format = NULL; /* csv or json, to run benchmark */
+  const char *generate_path = NULL; /* file to write random instances to */
+  const char *external_dir = NULL; /* directory of layers of external-memory bfs */
+  int depth = -1; /* optimal depth of generated instances, any if < 0 */
+  bool engine_chosen = false, heuristic_chosen = false; /* by -e, -H, for benchmark */
+  const char *socket_path = NULL; /* answer requests of connections to Unix socket */
+  long cache_entries = 0; /* entries of solution cache, none if 0 */
+  memory_bound bound; /* checks -M before any solve */
+  int status = -1; /* exit status of batch or server, -1 for random instances */
+  int (*heuristic)(unsigned long state, int nmoves) = manhattan_distance_heuristic;
+
+  while ((opt = getopt(argc, argv, "b:o:B:s:p:e:H:f:n:t:ru:m:R:g:d:c:M:w:T:X:x:")) != -1) {
+    switch (opt) {
+    case 'b':
+      return oracle_build(optarg) ? 0 : 1;
+    case 'o':
+      if (!oracle_load(optarg)) return 1;
+      heuristic = oracle_heuristic;
+      break;
+    case 'B':
+      pdb_path = optarg;
+      break;
+    case 's':
+      pdb_spec = optarg;
+      break;
+    case 'p':
+      if (!pdb_load(optarg)) return 1;
+      heuristic = pdb_heuristic;
+      break;
+    case 'H':
+      heuristic = heuristic_by_name(optarg);
+      if (!heuristic) {
+	usage(argv[0]);
+	return 1;
+      }
+      heuristic_chosen = true;
+      break;
+    case 'e':
+      engine = engine_by_name(optarg);
+      if (engine < 0) {
+	usage(argv[0]);
+	return 1;
+      }
+      engine_chosen = true;
+      break;
+    case 'f':
+      instances_path = optarg;
+      break;
+    case 'n':
+      ninstances = atoi(optarg);
+      break;
+    case 'r':
+      serve = true;
+      break;
+    case 'm':
+      if (strcmp(optarg, "csv") != 0 && strcmp(optarg, "json") != 0) {
+	usage(argv[0]);
+	return 1;
+      }
+      bench_format = optarg;
+      break;
+    case 'R':
+      random_seed = strtoul(optarg, NULL, 0);
+      break;
+    case 'g':
+      generate_path = optarg;
+      break;
+    case 'x':
+      external_dir = optarg;
+      break;
+    case 'd':
+      depth = atoi(optarg);
+      break;
+    case 'u':
+      socket_path = optarg;
+      break;
+    case 'M':
+      memory_budget = bytes_by_text(optarg);
+      if (memory_budget < 0) {
+	usage(argv[0]);
+	return 1;
+      }
+      break;
+    case 'w':
+      query_budget.weight = atof(optarg);
+      if (query_budget.weight < 1 || query_budget.weight > ANYTIME_MAX_WEIGHT) {
+	usage(argv[0]);
+	return 1;
+      }
+      break;
+    case 'T':
+      query_budget.seconds = atof(optarg);
+      break;
+    case 'X':
+      query_budget.expansions = atol(optarg);
+      break;
+    case 'c':
+      cache_entries = atol(optarg);
+      if (cache_entries < 1) {
+	usage(argv[0]);
+	return 1;
+      }
+      break;
+    case 't':
+      nthreads = atoi(optarg);
+      if (nthreads < 1) {
+	usage(argv[0]);
+	return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (pdb_path) {
+    return pdb_build(pdb_path, pdb_spec, external_dir,
+		     memory_budget > 0 ? memory_budget : EXTERNAL_RUN_BYTES) ? 0 : 1;
+  }
+  if (external_dir) {
+    return external_bfs(external_dir, depth, memory_budget > 0 ? memory_budget : EXTERNAL_RUN_BYTES) ? 0 : 1;
+  }
+  if (memory_budget > 0 && !memory_bound_init(&bound, memory_budget)) {
+    return 1;
+  }
+  if ((engine == ENGINE_ORACLE || heuristic == oracle_heuristic) && !oracle) {
+    log_err("oracle needs an oracle file (-o)");
+    return 1;
+  }
+  if (oracle && (bench_format || (heuristic == oracle_heuristic && engine != ENGINE_ORACLE)) &&
+      !oracle_heuristic_init()) {
+    return 1;
+  }
+  if (heuristic == pdb_heuristic && !pdb.map) {
+    log_err("pdb heuristic needs a pattern database file (-p)");
+    return 1;
+  }
+
+  if (generate_path) {
+    return generate_instances(generate_path, ninstances > 0 ? ninstances : ITERATIONS, depth) ? 0 : 1;
+  }
+  if (bench_format) {
+    return run_bench(instances_path, ninstances, nthreads, engine_chosen ? engine : -1,
+		     heuristic_chosen ? heuristic : NULL, strcmp(bench_format, "json") == 0) ? 0 : 1;
+  }
+  if (cache_entries > 0) {
+    cache = cache_init(cache_entries);
+    if (!cache) return 1;
+  }
+  if (serve) {
+    status = serve_stdin(engine, heuristic, nthreads) ? 0 : 1;
+  } else if (socket_path) {
+    status = serve_socket(socket_path, engine, heuristic, nthreads) ? 0 : 1;
+  } else if (instances_path || ninstances > 0) {
+    status = run_batch(instances_path, ninstances, nthreads, engine, heuristic) ? 0 : 1;
+  }
+  if (status >= 0) {
+    if (cache) cache_free(cache);
+    return status;
+  }
 
   int iterations;
   double timings[ITERATIONS]; /* array to store timings */
   int expanded[ITERATIONS]; /* array to store number of expanded (discovered / processed) states */
   double total = 0; /* total time taken */
   int total_expanded = 0; /* total expanded states */
+  solver_ctx *ctx = solver_init(engine, heuristic, nthreads); /* reused across instances */
+  solution sol;
+  if (!ctx) return 1;
  
   for (iterations = 0; iterations < ITERATIONS; iterations++) {
     
     unsigned long initial_state = random_state(); /* initialize random state */
-    puzzle *boardp = board_init(initial_state, 0, 0); /* initialize board */
-    priorityQ *priorityQp = priorityQ_init(); /* initialize priority queue */
-    hash_node *closed = closed_init(); /* initialize closed set */
-  
-    clock_t start, end;
-    long double cpu_time_used;
-  
-    priorityQ_insert(priorityQp, boardp, 0);
-    closed_discover(closed, initial_state, 0, 0);
 
-    start = clock();
-    boardp = a_star(priorityQp, closed, manhattan_distance_heuristic); /* solve the board */
-    end = clock();
-    cpu_time_used = ((long double)(end - start))/ CLOCKS_PER_SEC; /* in seconds */
-
-    priorityQ_free(priorityQp);
+    solver_solve(ctx, initial_state, &sol); /* solve the board */
   
-    //trace(closed, boardp->state); /* for tracing optimal move sequence */
-    //log_info("number of moves is %d", boardp->nmoves);
-    //log_info("time take ins %Lf", cpu_time_used);
+    //print_solution(stdout, &sol); /* for tracing optimal move sequence */
+    STAT(print_stats(stderr, &sol));
     
-    expanded[iterations] = closed_free(closed);
-    timings[iterations] = cpu_time_used;
-    free(boardp); 
-  
+    expanded[iterations] = sol.expanded;
+    timings[iterations] = sol.seconds;
   }
 
   for (iterations = 0; iterations < ITERATIONS; iterations ++) {
@@ -706,6 +5580,11 @@ int main(int argc, char *argv[])
   
   log_info("average time taken is %lfs", (double)(total/ITERATIONS));
   log_info("average expanded is %d", total_expanded/ITERATIONS);
-  
+
+  solver_report(ctx);
+  solver_free(ctx);
+  if (cache) cache_free(cache);
+  oracle_free();
+  pdb_free();
   return 0;
 }